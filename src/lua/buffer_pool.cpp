@@ -0,0 +1,160 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "buffer_pool.hpp"
+#include "common.hpp"
+#include "function.hpp"
+#include "memory.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    static const size_t min_class_size = 64;
+    static const size_t default_max_size = 16 * 1024 * 1024;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // Returns the index of the smallest class which holds the size, or npos
+    // if the size is too large to be rounded up.
+    size_t find_class(size_t size) {
+      size_t index = 0;
+      for (size_t n = min_class_size; n < size; n <<= 1) {
+        if (n > static_cast<size_t>(-1) / 2) {
+          return npos;
+        }
+        ++index;
+      }
+      return index;
+    }
+
+    using buffer_pool_reference_t = std::shared_ptr<buffer_pool_t>;
+
+    buffer_pool_reference_t* check_buffer_pool_reference(lua_State* L, int arg) {
+      return check_udata<buffer_pool_reference_t>(L, arg, "brigid.buffer_pool");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_buffer_pool_reference(L, 1)->~buffer_pool_reference_t();
+    }
+
+    void impl_call(lua_State* L) {
+      size_t max_size = default_max_size;
+      if (!lua_isnoneornil(L, 2)) {
+        if (get_field(L, 2, "max_size") != LUA_TNIL) {
+          max_size = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+      }
+      new_userdata<buffer_pool_reference_t>(L, "brigid.buffer_pool", std::make_shared<buffer_pool_t>(max_size, get_memory_usage(L)));
+    }
+
+    void impl_get_stats(lua_State* L) {
+      buffer_pool_t* self = check_buffer_pool_reference(L, 1)->get();
+      lua_createtable(L, 0, 3);
+      push_integer(L, self->hits());
+      lua_setfield(L, -2, "hits");
+      push_integer(L, self->misses());
+      lua_setfield(L, -2, "misses");
+      push_integer(L, self->retained_size());
+      lua_setfield(L, -2, "retained_size");
+    }
+
+    void impl_clear(lua_State* L) {
+      check_buffer_pool_reference(L, 1)->get()->clear();
+    }
+  }
+
+  buffer_pool_t::buffer_pool_t(size_t max_size, const std::shared_ptr<memory_usage_t>& memory_usage)
+    : max_size_(max_size),
+      memory_usage_(memory_usage),
+      hits_(),
+      misses_(),
+      retained_size_() {}
+
+  buffer_pool_t::~buffer_pool_t() {
+    clear();
+  }
+
+  std::unique_ptr<char[]> buffer_pool_t::acquire(size_t& capacity) {
+    size_t index = find_class(capacity);
+    if (index != npos) {
+      capacity = min_class_size << index;
+      if (index < classes_.size() && !classes_[index].empty()) {
+        ++hits_;
+        std::unique_ptr<char[]> data = std::move(classes_[index].back());
+        classes_[index].pop_back();
+        retained_size_ -= capacity;
+        memory_usage_->move(memory_buffer_pool, memory_data_writer, capacity);
+        return data;
+      }
+    }
+    ++misses_;
+    std::unique_ptr<char[]> data(new char[capacity]);
+    memory_usage_->increase(memory_data_writer, capacity);
+    return data;
+  }
+
+  // A buffer which is not of a size class is freed.
+  void buffer_pool_t::release(std::unique_ptr<char[]>&& data, size_t capacity) {
+    if (!data) {
+      return;
+    }
+    size_t index = find_class(capacity);
+    if (index == npos || capacity != min_class_size << index || capacity > max_size_ - retained_size_) {
+      data.reset();
+      memory_usage_->decrease(memory_data_writer, capacity);
+      return;
+    }
+    if (classes_.size() <= index) {
+      classes_.resize(index + 1);
+    }
+    classes_[index].push_back(std::move(data));
+    retained_size_ += capacity;
+    memory_usage_->move(memory_data_writer, memory_buffer_pool, capacity);
+  }
+
+  void buffer_pool_t::clear() {
+    classes_.clear();
+    memory_usage_->decrease(memory_buffer_pool, retained_size_);
+    retained_size_ = 0;
+  }
+
+  size_t buffer_pool_t::hits() const {
+    return hits_;
+  }
+
+  size_t buffer_pool_t::misses() const {
+    return misses_;
+  }
+
+  size_t buffer_pool_t::retained_size() const {
+    return retained_size_;
+  }
+
+  std::shared_ptr<buffer_pool_t> check_buffer_pool(lua_State* L, int arg) {
+    return *check_buffer_pool_reference(L, arg);
+  }
+
+  void initialize_buffer_pool(lua_State* L) {
+    lua_newtable(L);
+    {
+      new_metatable(L, "brigid.buffer_pool");
+      lua_pushvalue(L, -2);
+      lua_setfield(L, -2, "__index");
+      decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+      lua_pop(L, 1);
+
+      decltype(function<impl_call>())::set_metafield(L, -1, "__call");
+      decltype(function<impl_get_stats>())::set_field(L, -1, "get_stats");
+      decltype(function<impl_clear>())::set_field(L, -1, "clear");
+    }
+    lua_setfield(L, -2, "buffer_pool");
+  }
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_BUFFER_POOL_HPP
+#define BRIGID_BUFFER_POOL_HPP
+
+#include "memory.hpp"
+#include "noncopyable.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+namespace brigid {
+  // Recycles buffers in power-of-two size classes. A released buffer is
+  // retained while the total size of the retained buffers does not exceed
+  // max_size. The pool is shared by its Lua object and the writers using it.
+  // The buffers are counted as the memory of data_writer while in use.
+  class buffer_pool_t : private noncopyable {
+  public:
+    buffer_pool_t(size_t, const std::shared_ptr<memory_usage_t>&);
+    ~buffer_pool_t();
+    // Returns a buffer of at least the capacity, which is rounded up to its
+    // size class.
+    std::unique_ptr<char[]> acquire(size_t&);
+    void release(std::unique_ptr<char[]>&&, size_t);
+    void clear();
+    size_t hits() const;
+    size_t misses() const;
+    size_t retained_size() const;
+
+  private:
+    size_t max_size_;
+    std::shared_ptr<memory_usage_t> memory_usage_;
+    std::vector<std::vector<std::unique_ptr<char[]> > > classes_;
+    size_t hits_;
+    size_t misses_;
+    size_t retained_size_;
+  };
+
+  std::shared_ptr<buffer_pool_t> check_buffer_pool(lua_State*, int);
+}
+
+#endif
@@ -0,0 +1,419 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "decoder.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "noncopyable.hpp"
+#include "thread_reference.hpp"
+#include "view.hpp"
+#include "writer.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    enum cbor_major_t {
+      cbor_unsigned,
+      cbor_negative,
+      cbor_bytes,
+      cbor_text,
+      cbor_array,
+      cbor_map,
+      cbor_tag,
+      cbor_simple,
+    };
+
+    double decode_half(uint16_t half) {
+      int exponent = (half >> 10) & 0x1F;
+      int mantissa = half & 0x3FF;
+      double value = 0;
+      if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+      } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+      } else if (mantissa == 0) {
+        value = std::numeric_limits<double>::infinity();
+      } else {
+        value = std::numeric_limits<double>::quiet_NaN();
+      }
+      return half & 0x8000 ? -value : value;
+    }
+
+    // Decodes a CBOR data item. Both null and undefined are pushed as the
+    // null value, and the tags are skipped. Byte strings and text strings
+    // are pushed as they are, or as views into the source if view_threshold
+    // is set.
+    class cbor_parser_t : private decoder_t {
+    public:
+      cbor_parser_t(const char* data, size_t size, int null_index, int array_index, size_t view_threshold, const std::shared_ptr<view_reference_t>& view_ref)
+        : decoder_t("cbor", data, size, null_index, array_index),
+          view_threshold_(view_threshold),
+          view_ref_(view_ref) {}
+
+      void parse(lua_State* L) {
+        if (push_value(L, 0)) {
+          --p_;
+          error();
+        }
+        if (p_ != pe_) {
+          error();
+        }
+      }
+
+    private:
+      size_t view_threshold_;
+      std::shared_ptr<view_reference_t> view_ref_;
+      std::string buffer_;
+
+      // Reads the argument of the head. Returns false if the length is
+      // indefinite.
+      bool read_argument(int info, uint64_t& value) {
+        if (info < 24) {
+          value = info;
+        } else if (info <= 27) {
+          value = read_uint(static_cast<size_t>(1) << (info - 24));
+        } else if (info == 31) {
+          return false;
+        } else {
+          --p_;
+          error();
+        }
+        return true;
+      }
+
+      void push_string(lua_State* L, int major, int info) {
+        uint64_t size = 0;
+        if (read_argument(info, size)) {
+          need(size);
+          const char* data = reinterpret_cast<const char*>(p_);
+          if (view_threshold_ && size >= view_threshold_) {
+            new_view(L, data, size, view_ref_);
+          } else {
+            lua_pushlstring(L, data, size);
+          }
+          p_ += size;
+          return;
+        }
+
+        // The chunks of an indefinite-length string are definite-length
+        // strings of the same major type.
+        buffer_.clear();
+        while (true) {
+          need(1);
+          uint8_t c = *p_++;
+          if (c == 0xFF) {
+            break;
+          }
+          if (c >> 5 != major || !read_argument(c & 0x1F, size)) {
+            --p_;
+            error();
+          }
+          need(size);
+          buffer_.append(reinterpret_cast<const char*>(p_), size);
+          p_ += size;
+        }
+        lua_pushlstring(L, buffer_.data(), buffer_.size());
+      }
+
+      void push_array(lua_State* L, int info, int depth) {
+        uint64_t size = 0;
+        bool definite = read_argument(info, size);
+        // Each element has at least one byte.
+        if (definite) {
+          need(size);
+        }
+        new_array(L, definite ? static_cast<int>(size) : 0);
+        for (lua_Integer i = 1; !definite || static_cast<uint64_t>(i) <= size; ++i) {
+          if (push_value(L, depth + 1)) {
+            if (definite) {
+              --p_;
+              error();
+            }
+            break;
+          }
+          lua_rawseti(L, -2, i);
+        }
+      }
+
+      void push_map(lua_State* L, int info, int depth) {
+        uint64_t size = 0;
+        bool definite = read_argument(info, size);
+        if (definite) {
+          need_pairs(size);
+        }
+        new_map(L, definite ? static_cast<int>(size) : 0);
+        for (uint64_t i = 0; !definite || i < size; ++i) {
+          const uint8_t* p = p_;
+          if (push_value(L, depth + 1)) {
+            if (definite) {
+              --p_;
+              error();
+            }
+            break;
+          }
+          check_key(L, p);
+          if (push_value(L, depth + 1)) {
+            --p_;
+            error();
+          }
+          lua_rawset(L, -3);
+        }
+      }
+
+      void push_simple(lua_State* L, int info) {
+        switch (info) {
+          case 20:
+            lua_pushboolean(L, false);
+            return;
+          case 21:
+            lua_pushboolean(L, true);
+            return;
+          case 22:
+          case 23:
+            push_null(L);
+            return;
+          case 25:
+            lua_pushnumber(L, decode_half(static_cast<uint16_t>(read_uint(2))));
+            return;
+          case 26:
+            push_float(L);
+            return;
+          case 27:
+            push_double(L);
+            return;
+        }
+        // The other simple values are not supported.
+        --p_;
+        error();
+      }
+
+      // Returns true without pushing a value if the break code is read.
+      bool push_value(lua_State* L, int depth) {
+        check_depth(depth);
+        need(1);
+        uint8_t c = *p_++;
+        if (c == 0xFF) {
+          return true;
+        }
+
+        int major = c >> 5;
+        int info = c & 0x1F;
+        uint64_t value = 0;
+        switch (major) {
+          case cbor_unsigned:
+            if (!read_argument(info, value)) {
+              --p_;
+              error();
+            }
+            push_integer(L, value);
+            break;
+          case cbor_negative:
+            if (!read_argument(info, value)) {
+              --p_;
+              error();
+            }
+            if (value <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+              push_integer(L, -1 - static_cast<int64_t>(value));
+            } else {
+              lua_pushnumber(L, -1 - static_cast<lua_Number>(value));
+            }
+            break;
+          case cbor_bytes:
+          case cbor_text:
+            push_string(L, major, info);
+            break;
+          case cbor_array:
+            push_array(L, info, depth);
+            break;
+          case cbor_map:
+            push_map(L, info, depth);
+            break;
+          case cbor_tag:
+            if (!read_argument(info, value) || push_value(L, depth + 1)) {
+              --p_;
+              error();
+            }
+            break;
+          case cbor_simple:
+            push_simple(L, info);
+            break;
+        }
+        return false;
+      }
+    };
+
+    // Writes indefinite-length arrays and maps piece by piece, so that a
+    // large array can be emitted as it is produced. The reference thread
+    // holds the writer at index 1. Several top-level items are written as a
+    // CBOR sequence.
+    class cbor_encoder_t : private noncopyable {
+    public:
+      explicit cbor_encoder_t(thread_reference&& ref)
+        : ref_(std::move(ref)),
+          after_key_() {}
+
+      void begin(cbor_major_t major) {
+        writer_t* writer = begin_value();
+        write_cbor_indefinite(writer, major);
+        stack_.push_back(major);
+      }
+
+      void end(cbor_major_t major) {
+        if (stack_.empty() || stack_.back() != major || after_key_) {
+          throw BRIGID_LOGIC_ERROR(major == cbor_map ? "unexpected end_object" : "unexpected end_array");
+        }
+        write_cbor_break(get_writer());
+        stack_.pop_back();
+      }
+
+      void key(lua_State* L, int index) {
+        if (stack_.empty() || stack_.back() != cbor_map || after_key_) {
+          throw BRIGID_LOGIC_ERROR("unexpected key");
+        }
+        write_cbor(L, get_writer(), index);
+        after_key_ = true;
+      }
+
+      void value(lua_State* L, int index) {
+        write_cbor(L, begin_value(), index);
+      }
+
+    private:
+      thread_reference ref_;
+      std::vector<cbor_major_t> stack_;
+      bool after_key_;
+
+      writer_t* get_writer() const {
+        writer_t* writer = to_writer(ref_.get(), 1);
+        if (writer->closed()) {
+          throw BRIGID_LOGIC_ERROR("attempt to use a closed brigid.writer");
+        }
+        return writer;
+      }
+
+      writer_t* begin_value() {
+        if (!stack_.empty() && stack_.back() == cbor_map) {
+          if (!after_key_) {
+            throw BRIGID_LOGIC_ERROR("key expected");
+          }
+          after_key_ = false;
+        }
+        return get_writer();
+      }
+    };
+
+    cbor_encoder_t* check_cbor_encoder(lua_State* L, int arg) {
+      return check_udata<cbor_encoder_t>(L, arg, "brigid.cbor.encoder");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_cbor_encoder(L, 1)->~cbor_encoder_t();
+    }
+
+    void impl_call(lua_State* L) {
+      check_writer(L, 2);
+
+      thread_reference ref(L);
+      lua_pushvalue(L, 2);
+      lua_xmove(L, ref.get(), 1);
+
+      new_userdata<cbor_encoder_t>(L, "brigid.cbor.encoder", std::move(ref));
+    }
+
+    void impl_begin_object(lua_State* L) {
+      check_cbor_encoder(L, 1)->begin(cbor_map);
+    }
+
+    void impl_end_object(lua_State* L) {
+      check_cbor_encoder(L, 1)->end(cbor_map);
+    }
+
+    void impl_begin_array(lua_State* L) {
+      check_cbor_encoder(L, 1)->begin(cbor_array);
+    }
+
+    void impl_end_array(lua_State* L) {
+      check_cbor_encoder(L, 1)->end(cbor_array);
+    }
+
+    void impl_key(lua_State* L) {
+      cbor_encoder_t* self = check_cbor_encoder(L, 1);
+      luaL_checkany(L, 2);
+      self->key(L, 2);
+    }
+
+    void impl_value(lua_State* L) {
+      cbor_encoder_t* self = check_cbor_encoder(L, 1);
+      luaL_checkany(L, 2);
+      self->value(L, 2);
+    }
+
+    int impl_parse(lua_State* L) {
+      data_t data = check_data(L, 1);
+
+      int top = lua_gettop(L);
+      int null_index = top >= 2 ? 2 : 0;
+      luaL_getmetatable(L, "brigid.json.array");
+      int array_index = top + 1;
+
+      size_t view_threshold = 0;
+      std::shared_ptr<view_reference_t> view_ref;
+      if (top >= 3) {
+        if (get_field(L, 3, "view_threshold") != LUA_TNIL) {
+          view_threshold = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+        if (view_threshold) {
+          if (lua_type(L, 1) != LUA_TSTRING) {
+            throw BRIGID_LOGIC_ERROR("view_threshold needs a string source");
+          }
+          view_ref = std::make_shared<view_reference_t>(L);
+          lua_pushvalue(L, 1);
+          lua_xmove(L, view_ref->get(), 1);
+        }
+      }
+
+      cbor_parser_t(data.data(), data.size(), null_index, array_index, view_threshold, view_ref).parse(L);
+      return 1;
+    }
+  }
+
+  void initialize_cbor(lua_State* L) {
+    lua_newtable(L);
+    {
+      decltype(function<impl_parse>())::set_field(L, -1, "parse");
+
+      lua_newtable(L);
+      {
+        new_metatable(L, "brigid.cbor.encoder");
+        lua_pushvalue(L, -2);
+        lua_setfield(L, -2, "__index");
+        decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+        lua_pop(L, 1);
+
+        decltype(function<impl_call>())::set_metafield(L, -1, "__call");
+        decltype(memory_function<impl_begin_object>())::set_field(L, -1, "begin_object");
+        decltype(memory_function<impl_end_object>())::set_field(L, -1, "end_object");
+        decltype(memory_function<impl_begin_array>())::set_field(L, -1, "begin_array");
+        decltype(memory_function<impl_end_array>())::set_field(L, -1, "end_array");
+        decltype(memory_function<impl_key>())::set_field(L, -1, "key");
+        decltype(memory_function<impl_value>())::set_field(L, -1, "value");
+      }
+      lua_setfield(L, -2, "encoder");
+    }
+    lua_setfield(L, -2, "cbor");
+  }
+}
@@ -1,13 +1,15 @@
-// Copyright (c) 2019,2021,2022,2024 <dev@brigid.jp>
+// Copyright (c) 2019,2021,2022,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
 #include "crypto.hpp"
 #include "error.hpp"
+#include "memory.hpp"
 #include "scope_exit.hpp"
 #include "stack_guard.hpp"
 #include "thread_reference.hpp"
 #include "view.hpp"
+#include "writer.hpp"
 
 #include <lua.hpp>
 
@@ -18,12 +20,34 @@ namespace brigid {
     : in_size_(),
       out_size_(),
       ref_(std::move(ref)),
-      running_() {}
+      writer_(),
+      memory_usage_(),
+      running_() {
+    if (lua_State* L = ref_.get()) {
+      writer_ = to_writer(L, 1);
+      memory_usage_ = get_memory_usage(L);
+    }
+  }
 
-  cryptor::~cryptor() {}
+  // The buffer is allocated only by update, which requires the reference.
+  cryptor::~cryptor() {
+    if (!buffer_.empty()) {
+      memory_usage_->decrease(memory_cryptor, buffer_.size());
+    }
+  }
 
   void cryptor::update(const char* in_data, size_t in_size, bool padding) {
     in_size_ += in_size;
+    if (writer_) {
+      if (writer_->closed()) {
+        throw BRIGID_LOGIC_ERROR("attempt to use a closed brigid.writer");
+      }
+      char* out_data = writer_->prepare(impl_calculate_buffer_size(in_size_) - out_size_);
+      size_t result = impl_update(in_data, in_size, out_data, writer_->available(), padding);
+      writer_->commit(result);
+      out_size_ += result;
+      return;
+    }
     ensure_buffer_size(impl_calculate_buffer_size(in_size_) - out_size_);
     size_t result = impl_update(in_data, in_size, buffer_.data(), buffer_.size(), padding);
     out_size_ += result;
@@ -59,6 +83,7 @@ namespace brigid {
 
   void cryptor::ensure_buffer_size(size_t size) {
     if (buffer_.size() < size) {
+      memory_usage_->increase(memory_cryptor, size - buffer_.size());
       buffer_.resize(size);
     }
   }
@@ -1,22 +1,29 @@
-// Copyright (c) 2021,2022,2024 <dev@brigid.jp>
+// Copyright (c) 2021,2022,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
 #ifndef BRIGID_CRYPTO_HPP
 #define BRIGID_CRYPTO_HPP
 
+#include "memory.hpp"
 #include "noncopyable.hpp"
 #include "thread_reference.hpp"
 
 #include <lua.hpp>
 
 #include <stddef.h>
+#include <memory>
 #include <vector>
 
 namespace brigid {
   void open_cryptor();
   void open_hasher();
 
+  class writer_t;
+
+  // The output is passed to the callback as a view, or appended directly to
+  // the window of the writer if a data_writer or a file_writer is given
+  // instead of the callback.
   class cryptor {
   public:
     virtual ~cryptor() = 0;
@@ -33,6 +40,8 @@ namespace brigid {
     size_t out_size_;
     std::vector<char> buffer_;
     thread_reference ref_;
+    writer_t* writer_;
+    std::shared_ptr<memory_usage_t> memory_usage_;
     bool running_;
 
     void ensure_buffer_size(size_t);
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2022,2024 <dev@brigid.jp>
+// Copyright (c) 2019-2022,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -13,6 +13,7 @@
 
 #include <stddef.h>
 #include <utility>
+#include <vector>
 
 namespace brigid {
   namespace {
@@ -44,9 +45,15 @@ namespace brigid {
 
     void impl_update(lua_State* L) {
       cryptor* self = check_cryptor(L, 1);
-      data_t source = check_data(L, 2);
+      std::vector<data_t> segments;
+      check_data_segments(L, 2, segments);
       bool padding = lua_toboolean(L, 3);
-      self->update(source.data(), source.size(), padding);
+      if (segments.empty()) {
+        self->update(nullptr, 0, padding);
+      }
+      for (size_t i = 0; i < segments.size(); ++i) {
+        self->update(segments[i].data(), segments[i].size(), padding && i + 1 == segments.size());
+      }
     }
 
     void impl_encryptor(lua_State* L) {
@@ -97,8 +104,8 @@ namespace brigid {
       decltype(function<impl_close>())::set_field(L, -1, "__close");
       lua_pop(L, 1);
 
-      decltype(function<impl_update>())::set_field(L, -1, "update");
-      decltype(function<impl_close>())::set_field(L, -1, "close");
+      decltype(memory_function<impl_update>())::set_field(L, -1, "update");
+      decltype(memory_function<impl_close>())::set_field(L, -1, "close");
     }
     lua_setfield(L, -2, "cryptor");
 
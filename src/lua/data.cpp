@@ -1,4 +1,4 @@
-// Copyright (c) 2019,2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019,2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -11,6 +11,7 @@
 
 #include <stddef.h>
 #include <string>
+#include <vector>
 
 namespace brigid {
   namespace {
@@ -32,6 +33,16 @@ namespace brigid {
 
   abstract_data_t::~abstract_data_t() {}
 
+  void abstract_data_t::get_segments(std::vector<data_t>& segments) {
+    segments.emplace_back(data(), size());
+  }
+
+  // Returns the total size dropped from the front of the data, so that a
+  // reader which keeps offsets can detect that they are shifted.
+  size_t abstract_data_t::consumed() const {
+    return 0;
+  }
+
   data_t::data_t()
     : initialized_(),
       data_(),
@@ -56,7 +67,7 @@ namespace brigid {
 
   data_t to_data(lua_State* L, int index) {
     if (lua_isuserdata(L, index)) {
-      const abstract_data_t* self = to_abstract_data_data_writer(L, index);
+      abstract_data_t* self = to_abstract_data_data_writer(L, index);
       if (!self) {
         self = to_abstract_data_view(L, index);
       }
@@ -81,7 +92,7 @@ namespace brigid {
 
   data_t check_data(lua_State* L, int arg) {
     if (lua_isuserdata(L, arg)) {
-      const abstract_data_t* self = to_abstract_data_data_writer(L, arg);
+      abstract_data_t* self = to_abstract_data_data_writer(L, arg);
       if (!self) {
         self = to_abstract_data_view(L, arg);
       }
@@ -104,4 +115,16 @@ namespace brigid {
       return data_t(data, size);
     }
   }
+
+  // Gets the data as a list of contiguous segments without joining them.
+  void check_data_segments(lua_State* L, int arg, std::vector<data_t>& segments) {
+    if (abstract_data_t* self = to_abstract_data_data_writer(L, arg)) {
+      if (self->closed()) {
+        luaL_argerror(L, arg, "attempt to use a closed brigid.data");
+      }
+      self->get_segments(segments);
+    } else {
+      segments.push_back(check_data(L, arg));
+    }
+  }
 }
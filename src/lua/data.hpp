@@ -1,4 +1,4 @@
-// Copyright (c) 2019,2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019,2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -8,14 +8,20 @@
 #include <lua.hpp>
 
 #include <stddef.h>
+#include <vector>
 
 namespace brigid {
+  class data_t;
+
   class abstract_data_t {
   public:
     virtual ~abstract_data_t() = 0;
     virtual bool closed() const = 0;
-    virtual const char* data() const = 0;
+    // Not const because the data may be joined into one buffer.
+    virtual const char* data() = 0;
     virtual size_t size() const = 0;
+    virtual void get_segments(std::vector<data_t>&);
+    virtual size_t consumed() const;
   };
 
   class data_t {
@@ -36,6 +42,7 @@ namespace brigid {
 
   data_t to_data(lua_State*, int);
   data_t check_data(lua_State*, int);
+  void check_data_segments(lua_State*, int, std::vector<data_t>&);
 }
 
 #endif
@@ -1,67 +1,338 @@
-// Copyright (c) 2019,2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019,2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
+#include "buffer_pool.hpp"
 #include "common.hpp"
 #include "data.hpp"
+#include "error.hpp"
 #include "function.hpp"
+#include "memory.hpp"
 #include "noncopyable.hpp"
+#include "view.hpp"
 #include "writer.hpp"
 
 #include <lua.hpp>
 
 #include <stddef.h>
 #include <string.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace brigid {
   namespace {
+    // The views made by peek share the epoch, which is expired when the data
+    // is moved, consumed or released.
+    class epoch_t : public view_source_t {
+    public:
+      epoch_t()
+        : expired_() {}
+
+      virtual bool expired() const {
+        return expired_;
+      }
+
+      void expire() {
+        expired_ = true;
+      }
+
+    private:
+      bool expired_;
+    };
+
+    // The data is stored in one buffer which grows by doubling, or in a
+    // list of fixed-size segments if segment_size is not zero. In the
+    // segmented mode, the written data is moved only if data() or peek
+    // joins the segments into one buffer. If a pool is given, the buffers
+    // are taken from it and given back to it by close.
+    //
+    // consume drops a prefix of the data. The consumed space of a buffer is
+    // reclaimed by moving the rest to the front, which is done only when
+    // the rest is not longer than the consumed, and a consumed segment is
+    // released. Views made by peek are closed if the data is moved.
     class data_writer_t : public abstract_data_t, public writer_t, private noncopyable {
     public:
-      data_writer_t()
-        : closed_() {}
+      data_writer_t(size_t segment_size, const std::shared_ptr<buffer_pool_t>& pool, const std::shared_ptr<memory_usage_t>& memory_usage)
+        : segment_size_(segment_size),
+          pool_(pool),
+          memory_usage_(memory_usage),
+          base_(),
+          head_(),
+          consumed_(),
+          closed_() {}
+
+      ~data_writer_t() {
+        release_segments();
+      }
 
       virtual bool closed() const {
         return closed_;
       }
 
-      virtual const char* data() const {
-        return buffer_.data();
+      // Joins the segments first, which closes the views made by peek.
+      virtual const char* data() {
+        if (segments_.size() > 1) {
+          flatten();
+        }
+        return segments_.empty() ? nullptr : segments_.back().data.get() + head_;
       }
 
       virtual size_t size() const {
-        return buffer_.size();
+        return segments_.empty() ? 0 : base_ + (cursor_ - segments_.back().data.get()) - head_;
+      }
+
+      virtual void get_segments(std::vector<data_t>& segments) {
+        for (size_t i = 0; i < segments_.size(); ++i) {
+          const segment_t& segment = segments_[i];
+          size_t size = i + 1 < segments_.size() ? segment.size : cursor_ - segment.data.get();
+          size_t head = i == 0 ? head_ : 0;
+          if (size > head) {
+            segments.emplace_back(segment.data.get() + head, size - head);
+          }
+        }
       }
 
       void close() {
-        buffer_.clear();
+        release_segments();
+        base_ = 0;
+        head_ = 0;
+        cursor_ = nullptr;
+        limit_ = nullptr;
         closed_ = true;
       }
 
       void write_self() {
-        size_t size = buffer_.size();
-        buffer_.resize(size * 2);
-        char* data = buffer_.data();
-        memcpy(data + size, data, size);
+        if (segment_size_) {
+          // The segments are not moved by writing.
+          std::vector<data_t> segments;
+          get_segments(segments);
+          for (size_t i = 0; i < segments.size(); ++i) {
+            write(segments[i].data(), segments[i].size());
+          }
+        } else if (size_t size = this->size()) {
+          grow(size);
+          memcpy(cursor_, segments_.back().data.get() + head_, size);
+          cursor_ += size;
+        }
       }
 
-      virtual void write(const char* data, size_t size) {
-        size_t position = buffer_.size();
-        buffer_.resize(position + size);
-        memcpy(buffer_.data() + position, data, size);
+      void reserve(size_t size) {
+        if (!segment_size_ && capacity() < size) {
+          resize(size);
+        }
       }
 
-      virtual void write(char c) {
-        buffer_.push_back(c);
+      virtual size_t consumed() const {
+        return consumed_;
       }
 
-      void reserve(size_t size) {
-        buffer_.reserve(size);
+      void consume(size_t size) {
+        expire_views();
+        consumed_ += size;
+        head_ += size;
+        size_t n = 0;
+        while (n + 1 < segments_.size() && head_ >= segments_[n].size) {
+          head_ -= segments_[n].size;
+          base_ -= segments_[n].size;
+          deallocate(segments_[n]);
+          ++n;
+        }
+        if (n > 0) {
+          segments_.erase(segments_.begin(), segments_.begin() + n);
+        }
+        if (segments_.size() == 1 && cursor_ == segments_.back().data.get() + head_) {
+          // The buffer is reused from the front without moving.
+          cursor_ = segments_.back().data.get();
+          head_ = 0;
+        }
+      }
+
+      // The view is closed if the data is moved, consumed or released. The
+      // segments are joined into one buffer by data().
+      view_t* peek(lua_State* L) {
+        const char* data = this->data();
+        size_t size = this->size();
+        if (!data) {
+          data = "";
+        }
+        if (!epoch_) {
+          epoch_ = std::make_shared<epoch_t>();
+        }
+        return new_view(L, data, size, epoch_);
       }
 
     private:
-      std::vector<char> buffer_;
+      struct segment_t {
+        std::unique_ptr<char[]> data;
+        size_t size; // used size of a segment which is not the last
+        size_t capacity;
+      };
+
+      size_t segment_size_;
+      std::shared_ptr<buffer_pool_t> pool_;
+      std::shared_ptr<memory_usage_t> memory_usage_;
+      std::vector<segment_t> segments_;
+      size_t base_; // total size of the segments but the last
+      size_t head_; // consumed size of the first segment
+      size_t consumed_; // total consumed size
+      std::shared_ptr<epoch_t> epoch_;
       bool closed_;
+
+      size_t capacity() const {
+        return segments_.empty() ? 0 : limit_ - segments_.back().data.get();
+      }
+
+      // The capacity may be rounded up by the pool.
+      std::unique_ptr<char[]> allocate(size_t& capacity) {
+        if (pool_) {
+          return pool_->acquire(capacity);
+        }
+        std::unique_ptr<char[]> data(new char[capacity]);
+        memory_usage_->increase(memory_data_writer, capacity);
+        return data;
+      }
+
+      void deallocate(segment_t& segment) {
+        if (pool_) {
+          pool_->release(std::move(segment.data), segment.capacity);
+        } else if (segment.data) {
+          segment.data.reset();
+          memory_usage_->decrease(memory_data_writer, segment.capacity);
+        }
+      }
+
+      void expire_views() {
+        if (epoch_) {
+          epoch_->expire();
+          epoch_ = nullptr;
+        }
+      }
+
+      void release_segments() {
+        expire_views();
+        for (size_t i = 0; i < segments_.size(); ++i) {
+          deallocate(segments_[i]);
+        }
+        segments_.clear();
+      }
+
+      // Replaces the last segment with a new buffer of the capacity, which
+      // must not be less than the size. The new region is not initialized.
+      void resize(size_t capacity) {
+        size_t size = this->size();
+        std::unique_ptr<char[]> data = allocate(capacity);
+        if (size > 0) {
+          memcpy(data.get(), segments_.back().data.get() + head_, size);
+        }
+        expire_views();
+        head_ = 0;
+        if (segments_.empty()) {
+          segments_.push_back(segment_t());
+        } else {
+          deallocate(segments_.back());
+        }
+        segment_t& segment = segments_.back();
+        segment.data = std::move(data);
+        segment.capacity = capacity;
+        cursor_ = segment.data.get() + size;
+        limit_ = segment.data.get() + capacity;
+      }
+
+      // Makes the window hold at least n bytes.
+      void grow(size_t n) {
+        size_t size = this->size();
+        size_t capacity = this->capacity();
+        if (n > capacity - size - head_) {
+          if (head_ >= size && n <= capacity - size) {
+            compact();
+          } else {
+            resize(std::max(std::max<size_t>(capacity * 2, 64), size + n));
+          }
+        }
+      }
+
+      // Moves the data to the front of the buffer.
+      void compact() {
+        expire_views();
+        char* data = segments_.back().data.get();
+        size_t size = this->size();
+        memmove(data, data + head_, size);
+        head_ = 0;
+        cursor_ = data + size;
+      }
+
+      void append_segment(size_t capacity) {
+        if (!segments_.empty()) {
+          segment_t& segment = segments_.back();
+          segment.size = cursor_ - segment.data.get();
+          base_ += segment.size;
+        }
+        segments_.push_back(segment_t());
+        segment_t& segment = segments_.back();
+        segment.data = allocate(capacity);
+        segment.capacity = capacity;
+        cursor_ = segment.data.get();
+        limit_ = cursor_ + capacity;
+      }
+
+      // Joins the segments into one buffer, which has a room of one segment
+      // for the following writes.
+      void flatten() {
+        size_t size = this->size();
+        size_t capacity = size + segment_size_;
+        std::unique_ptr<char[]> data = allocate(capacity);
+        char* p = data.get();
+        std::vector<data_t> segments;
+        get_segments(segments);
+        for (size_t i = 0; i < segments.size(); ++i) {
+          memcpy(p, segments[i].data(), segments[i].size());
+          p += segments[i].size();
+        }
+        release_segments();
+        segments_.push_back(segment_t());
+        segment_t& segment = segments_.back();
+        segment.data = std::move(data);
+        segment.capacity = capacity;
+        base_ = 0;
+        head_ = 0;
+        cursor_ = p;
+        limit_ = segment.data.get() + capacity;
+      }
+
+      virtual void refill(const char* data, size_t size) {
+        if (!segment_size_) {
+          grow(size);
+          memcpy(cursor_, data, size);
+          cursor_ += size;
+          return;
+        }
+
+        while (true) {
+          size_t n = std::min<size_t>(size, limit_ - cursor_);
+          if (n > 0) {
+            memcpy(cursor_, data, n);
+            cursor_ += n;
+            data += n;
+            size -= n;
+          }
+          if (size == 0) {
+            break;
+          }
+          append_segment(segment_size_);
+        }
+      }
+
+      // In the segmented mode, a segment larger than segment_size is
+      // appended if the window is requested to be so.
+      virtual void expand(size_t size) {
+        if (!segment_size_) {
+          grow(size);
+        } else {
+          append_segment(std::max(segment_size_, size));
+        }
+      }
     };
 
     data_writer_t* check_data_writer(lua_State* L, int arg, int validate = check_validate_all) {
@@ -86,7 +357,20 @@ namespace brigid {
     }
 
     void impl_call(lua_State* L) {
-      new_userdata<data_writer_t>(L, "brigid.data_writer");
+      size_t segment_size = 0;
+      std::shared_ptr<buffer_pool_t> pool;
+      if (!lua_isnoneornil(L, 2)) {
+        if (get_field(L, 2, "segment_size") != LUA_TNIL) {
+          segment_size = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+
+        if (get_field(L, 2, "pool") != LUA_TNIL) {
+          pool = check_buffer_pool(L, -1);
+        }
+        lua_pop(L, 1);
+      }
+      new_userdata<data_writer_t>(L, "brigid.data_writer", segment_size, pool, get_memory_usage(L));
     }
 
     void impl_get_pointer(lua_State* L) {
@@ -99,9 +383,21 @@ namespace brigid {
       push_integer(L, self->size());
     }
 
+    // The segments are concatenated without making a contiguous copy.
     void impl_get_string(lua_State* L) {
       data_writer_t* self = check_data_writer(L, 1);
-      lua_pushlstring(L, self->data(), self->size());
+      std::vector<data_t> segments;
+      self->get_segments(segments);
+      if (segments.size() <= 1) {
+        lua_pushlstring(L, self->data(), self->size());
+      } else {
+        luaL_Buffer buffer;
+        luaL_buffinit(L, &buffer);
+        for (size_t i = 0; i < segments.size(); ++i) {
+          luaL_addlstring(&buffer, segments[i].data(), segments[i].size());
+        }
+        luaL_pushresult(&buffer);
+      }
     }
 
     void impl_write(lua_State* L) {
@@ -109,11 +405,28 @@ namespace brigid {
       if (self == lua_touserdata(L, 2)) {
         self->write_self();
       } else {
-        data_t data = check_data(L, 2);
-        self->write(data.data(), data.size());
+        std::vector<data_t> segments;
+        check_data_segments(L, 2, segments);
+        for (size_t i = 0; i < segments.size(); ++i) {
+          self->write(segments[i].data(), segments[i].size());
+        }
       }
     }
 
+    void impl_consume(lua_State* L) {
+      data_writer_t* self = check_data_writer(L, 1);
+      size_t size = check_integer<size_t>(L, 2);
+      if (size > self->size()) {
+        throw BRIGID_LOGIC_ERROR("out of range");
+      }
+      self->consume(size);
+    }
+
+    void impl_peek(lua_State* L) {
+      data_writer_t* self = check_data_writer(L, 1);
+      self->peek(L);
+    }
+
     void impl_reserve(lua_State* L) {
       data_writer_t* self = check_data_writer(L, 1);
       size_t size = check_integer<size_t>(L, 2);
@@ -129,6 +442,10 @@ namespace brigid {
     return to_udata<data_writer_t>(L, arg, "brigid.data_writer");
   }
 
+  writer_t* new_data_writer(lua_State* L) {
+    return new_userdata<data_writer_t>(L, "brigid.data_writer", 0, std::shared_ptr<buffer_pool_t>(), get_memory_usage(L));
+  }
+
   void initialize_data_writer(lua_State* L) {
     lua_newtable(L);
     {
@@ -142,12 +459,14 @@ namespace brigid {
       lua_pop(L, 1);
 
       decltype(function<impl_call>())::set_metafield(L, -1, "__call");
-      decltype(function<impl_get_pointer>())::set_field(L, -1, "get_pointer");
+      decltype(memory_function<impl_get_pointer>())::set_field(L, -1, "get_pointer");
       decltype(function<impl_get_size>())::set_field(L, -1, "get_size");
       decltype(function<impl_get_string>())::set_field(L, -1, "get_string");
       decltype(function<impl_close>())::set_field(L, -1, "close");
-      decltype(function<impl_write>())::set_field(L, -1, "write");
-      decltype(function<impl_reserve>())::set_field(L, -1, "reserve");
+      decltype(memory_function<impl_write>())::set_field(L, -1, "write");
+      decltype(memory_function<impl_reserve>())::set_field(L, -1, "reserve");
+      decltype(function<impl_consume>())::set_field(L, -1, "consume");
+      decltype(memory_function<impl_peek>())::set_field(L, -1, "peek");
 
       initialize_writer(L);
     }
@@ -0,0 +1,119 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_DECODER_HPP
+#define BRIGID_DECODER_HPP
+
+#include "error.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sstream>
+
+namespace brigid {
+  // The common part of the decoders of the binary formats. The values are
+  // pushed in the same way as json.parse: nil is pushed as the null value if
+  // specified, and the arrays have the metatable of brigid.json.array.
+  class decoder_t : private noncopyable {
+  protected:
+    decoder_t(const char* name, const char* data, size_t size, int null_index, int array_index)
+      : name_(name),
+        pb_(reinterpret_cast<const uint8_t*>(data)),
+        p_(pb_),
+        pe_(pb_ + size),
+        null_index_(null_index),
+        array_index_(array_index) {}
+
+    const char* name_;
+    const uint8_t* const pb_;
+    const uint8_t* p_;
+    const uint8_t* const pe_;
+    int null_index_;
+    int array_index_;
+
+    [[noreturn]] void error() const {
+      std::ostringstream out;
+      out << "cannot parse " << name_ << " at position " << (p_ - pb_ + 1);
+      throw BRIGID_RUNTIME_ERROR(out.str());
+    }
+
+    void check_depth(int depth) const {
+      if (static_cast<size_t>(depth) >= json_max_depth) {
+        error();
+      }
+    }
+
+    void need(uint64_t size) const {
+      if (static_cast<uint64_t>(pe_ - p_) < size) {
+        error();
+      }
+    }
+
+    // Each key and value has at least one byte.
+    void need_pairs(uint64_t size) const {
+      if (size > static_cast<uint64_t>(pe_ - p_) / 2) {
+        error();
+      }
+    }
+
+    uint64_t read_uint(size_t size) {
+      need(size);
+      uint64_t value = 0;
+      for (size_t i = 0; i < size; ++i) {
+        value = value << 8 | *p_++;
+      }
+      return value;
+    }
+
+    void push_null(lua_State* L) const {
+      if (null_index_) {
+        lua_pushvalue(L, null_index_);
+      } else {
+        lua_pushnil(L);
+      }
+    }
+
+    void push_float(lua_State* L) {
+      uint32_t bits = static_cast<uint32_t>(read_uint(4));
+      float value = 0;
+      memcpy(&value, &bits, sizeof(value));
+      lua_pushnumber(L, value);
+    }
+
+    void push_double(lua_State* L) {
+      uint64_t bits = read_uint(8);
+      double value = 0;
+      memcpy(&value, &bits, sizeof(value));
+      lua_pushnumber(L, value);
+    }
+
+    void new_array(lua_State* L, int size) const {
+      lua_checkstack(L, 3);
+      lua_createtable(L, size, 0);
+      lua_pushvalue(L, array_index_);
+      lua_setmetatable(L, -2);
+    }
+
+    void new_map(lua_State* L, int size) const {
+      lua_checkstack(L, 3);
+      lua_createtable(L, 0, size);
+    }
+
+    // Rejects nil and NaN keys that cannot be set to a table. p is the
+    // position of the key.
+    void check_key(lua_State* L, const uint8_t* p) {
+      if (lua_isnil(L, -1) || (lua_type(L, -1) == LUA_TNUMBER && lua_tonumber(L, -1) != lua_tonumber(L, -1))) {
+        p_ = p;
+        error();
+      }
+    }
+  };
+}
+
+#endif
@@ -1,55 +1,210 @@
-// Copyright (c) 2019,2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019,2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "common.hpp"
 #include "data.hpp"
 #include "error.hpp"
 #include "function.hpp"
+#include "memory.hpp"
 #include "noncopyable.hpp"
+#include "scope_exit.hpp"
 #include "stdio.hpp"
 #include "writer.hpp"
 
 #include <lua.hpp>
 
+#if defined(HAVE_FALLOCATE) || defined(HAVE_POSIX_FADVISE)
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_WRITEV
+#include <sys/uio.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <vector>
 
 namespace brigid {
   namespace {
+    static const size_t default_buffer_size = 65536;
+
+    // If buffer_size is zero, the writer writes each piece by fwrite and
+    // uses the buffering of stdio. It has no window, except that a window
+    // requested by prepare is staged in a scratch buffer of the requested
+    // size, which is passed to fwrite by the next refill, flush or close.
+    //
+    // Otherwise, the writer disables the buffering of stdio and writes the
+    // data collected in its own buffer by a single call. The buffer is
+    // enlarged if a larger window is requested by prepare.
     class file_writer_t : public writer_t, private noncopyable {
     public:
-      explicit file_writer_t(const char* path)
-        : handle_(open_file_handle(path, "wb")) {}
+      file_writer_t(const char* path, size_t buffer_size, const std::shared_ptr<memory_usage_t>& memory_usage)
+        : handle_(open_file_handle(path, "wb")),
+          stdio_(buffer_size == 0),
+          buffer_(buffer_size),
+          memory_usage_(memory_usage) {
+        if (!stdio_) {
+          if (setvbuf(handle_.get(), nullptr, _IONBF, 0) != 0) {
+            throw BRIGID_SYSTEM_ERROR();
+          }
+          reset_window();
+        }
+        memory_usage_->increase(memory_file_writer, buffer_.size());
+      }
+
+      ~file_writer_t() {
+        try {
+          flush_buffer();
+        } catch (...) {}
+        memory_usage_->decrease(memory_file_writer, buffer_.size());
+      }
 
       bool closed() const {
         return !handle_;
       }
 
       void close() {
-        handle_.reset();
+        scope_exit scope_guard([&]() {
+          handle_.reset();
+          cursor_ = nullptr;
+          limit_ = nullptr;
+        });
+        flush_buffer();
       }
 
-      virtual void write(const char* data, size_t size) {
-        if (fwrite(data, 1, size, handle_.get()) != size) {
+      void flush() {
+        flush_buffer();
+        if (fflush(handle_.get()) != 0) {
           throw BRIGID_SYSTEM_ERROR();
         }
       }
 
-      virtual void write(char c) {
-        if (fputc(c, handle_.get()) == EOF) {
-          throw BRIGID_SYSTEM_ERROR();
+      void preallocate(size_t size) {
+#ifdef HAVE_FALLOCATE
+#ifdef FALLOC_FL_KEEP_SIZE
+        // Ignore errors because the file system may not support it.
+        fallocate(fileno(handle_.get()), FALLOC_FL_KEEP_SIZE, 0, size);
+#endif
+#else
+        (void) size;
+#endif
+      }
+
+      void advise_sequential() {
+#ifdef HAVE_POSIX_FADVISE
+        posix_fadvise(fileno(handle_.get()), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      }
+
+    private:
+      file_handle_t handle_;
+      bool stdio_;
+      std::vector<char> buffer_;
+      std::shared_ptr<memory_usage_t> memory_usage_;
+
+      void reset_window() {
+        cursor_ = buffer_.data();
+        limit_ = cursor_ + buffer_.size();
+      }
+
+      void flush_buffer() {
+        if (handle_ && cursor_ != buffer_.data()) {
+          size_t size = cursor_ - buffer_.data();
+          if (stdio_) {
+            cursor_ = buffer_.data();
+            limit_ = cursor_;
+            write_stdio(buffer_.data(), size);
+          } else {
+            reset_window();
+            write_file(buffer_.data(), size, nullptr, 0);
+          }
         }
       }
 
-      void flush() {
-        if (fflush(handle_.get()) != 0) {
+      void write_stdio(const char* data, size_t size) {
+        if (fwrite(data, 1, size, handle_.get()) != size) {
           throw BRIGID_SYSTEM_ERROR();
         }
       }
 
-    private:
-      file_handle_t handle_;
+      virtual void refill(const char* data, size_t size) {
+        if (stdio_) {
+          flush_buffer();
+          write_stdio(data, size);
+          return;
+        }
+
+        if (size >= buffer_.size()) {
+          size_t position = cursor_ - buffer_.data();
+          reset_window();
+          write_file(buffer_.data(), position, data, size);
+          return;
+        }
+        flush_buffer();
+        memcpy(cursor_, data, size);
+        cursor_ += size;
+      }
+
+      virtual void expand(size_t size) {
+        flush_buffer();
+        if (buffer_.size() < size) {
+          memory_usage_->increase(memory_file_writer, size - buffer_.size());
+          buffer_.resize(size);
+        }
+        if (stdio_) {
+          cursor_ = buffer_.data();
+          limit_ = cursor_ + size;
+        } else {
+          reset_window();
+        }
+      }
+
+      void write_file(const char* data1, size_t size1, const char* data2, size_t size2) {
+#ifdef HAVE_WRITEV
+        int fd = fileno(handle_.get());
+        while (size1 + size2 > 0) {
+          struct iovec iov[2] = {};
+          iov[0].iov_base = const_cast<char*>(data1);
+          iov[0].iov_len = size1;
+          iov[1].iov_base = const_cast<char*>(data2);
+          iov[1].iov_len = size2;
+          ssize_t result = size1 > 0 ? writev(fd, iov, 2) : ::write(fd, data2, size2);
+          if (result < 0) {
+            if (errno == EINTR) {
+              continue;
+            }
+            throw BRIGID_SYSTEM_ERROR();
+          }
+          size_t n = result;
+          if (n < size1) {
+            data1 += n;
+            size1 -= n;
+          } else {
+            n -= size1;
+            size1 = 0;
+            data2 += n;
+            size2 -= n;
+          }
+        }
+#else
+        if (fwrite(data1, 1, size1, handle_.get()) != size1) {
+          throw BRIGID_SYSTEM_ERROR();
+        }
+        if (size2 > 0 && fwrite(data2, 1, size2, handle_.get()) != size2) {
+          throw BRIGID_SYSTEM_ERROR();
+        }
+#endif
+      }
     };
 
     file_writer_t* check_file_writer(lua_State* L, int arg, int validate = check_validate_all) {
@@ -75,13 +230,41 @@ namespace brigid {
 
     void impl_call(lua_State* L) {
       const char* path = luaL_checkstring(L, 2);
-      new_userdata<file_writer_t>(L, "brigid.file_writer", path);
+      size_t buffer_size = default_buffer_size;
+      size_t preallocate = 0;
+      bool sequential = false;
+
+      if (lua_istable(L, 3)) {
+        if (get_field(L, 3, "buffer_size") != LUA_TNIL) {
+          buffer_size = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+
+        if (get_field(L, 3, "preallocate") != LUA_TNIL) {
+          preallocate = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+
+        sequential = get_field(L, 3, "sequential") != LUA_TNIL && lua_toboolean(L, -1);
+        lua_pop(L, 1);
+      }
+
+      file_writer_t* self = new_userdata<file_writer_t>(L, "brigid.file_writer", path, buffer_size, get_memory_usage(L));
+      if (preallocate > 0) {
+        self->preallocate(preallocate);
+      }
+      if (sequential) {
+        self->advise_sequential();
+      }
     }
 
     void impl_write(lua_State* L) {
       file_writer_t* self = check_file_writer(L, 1);
-      data_t data = check_data(L, 2);
-      self->write(data.data(), data.size());
+      std::vector<data_t> segments;
+      check_data_segments(L, 2, segments);
+      for (size_t i = 0; i < segments.size(); ++i) {
+        self->write(segments[i].data(), segments[i].size());
+      }
     }
 
     void impl_flush(lua_State* L) {
@@ -104,9 +287,9 @@ namespace brigid {
       decltype(function<impl_close>())::set_field(L, -1, "__close");
       lua_pop(L, 1);
 
-      decltype(function<impl_call>())::set_metafield(L, -1, "__call");
+      decltype(memory_function<impl_call>())::set_metafield(L, -1, "__call");
       decltype(function<impl_close>())::set_field(L, -1, "close");
-      decltype(function<impl_write>())::set_field(L, -1, "write");
+      decltype(memory_function<impl_write>())::set_field(L, -1, "write");
       decltype(function<impl_flush>())::set_field(L, -1, "flush");
 
       initialize_writer(L);
@@ -1,10 +1,12 @@
-// Copyright (c) 2021 <dev@brigid.jp>
+// Copyright (c) 2021,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
 #ifndef BRIGID_FUNCTION_HPP
 #define BRIGID_FUNCTION_HPP
 
+#include "memory.hpp"
+
 #include <lua.hpp>
 
 #include <exception>
@@ -16,14 +18,23 @@ namespace brigid {
     void set_metafield(lua_State*, int, const char*, lua_CFunction);
   }
 
-  template <class T, T (*)(lua_State*)>
+  // If report is true, the growth of the native memory during the call is
+  // reported to the garbage collector.
+  template <class T, T (*)(lua_State*), bool report>
   struct function_wrapper;
 
-  template <int (*T)(lua_State*)>
-  struct function_wrapper<int, T> {
+  template <int (*T)(lua_State*), bool report>
+  struct function_wrapper<int, T, report> {
     static int value(lua_State* L) {
       try {
-        return T(L);
+        if (report) {
+          clear_memory_report();
+        }
+        int result = T(L);
+        if (report) {
+          report_memory_usage(L);
+        }
+        return result;
       } catch (const std::runtime_error& e) {
         lua_pushnil(L);
         lua_pushstring(L, e.what());
@@ -42,12 +53,18 @@ namespace brigid {
     }
   };
 
-  template <void (*T)(lua_State*)>
-  struct function_wrapper<void, T> {
+  template <void (*T)(lua_State*), bool report>
+  struct function_wrapper<void, T, report> {
     static int value(lua_State* L) {
       try {
+        if (report) {
+          clear_memory_report();
+        }
         int top = lua_gettop(L);
         T(L);
+        if (report) {
+          report_memory_usage(L);
+        }
         int result = lua_gettop(L) - top;
         if (result > 0) {
           return result;
@@ -78,10 +95,18 @@ namespace brigid {
   };
 
   template <int (*T)(lua_State*)>
-  function_wrapper<int, T> function();
+  function_wrapper<int, T, false> function();
+
+  template <void (*T)(lua_State*)>
+  function_wrapper<void, T, false> function();
+
+  // For the functions which may grow the buffers of brigid.data_writer,
+  // brigid.file_writer or brigid.cryptor.
+  template <int (*T)(lua_State*)>
+  function_wrapper<int, T, true> memory_function();
 
   template <void (*T)(lua_State*)>
-  function_wrapper<void, T> function();
+  function_wrapper<void, T, true> memory_function();
 }
 
 #endif
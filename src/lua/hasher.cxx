@@ -2,7 +2,7 @@
 #line 1 "hasher.rl"
 // vim: syntax=ragel:
 
-// Copyright (c) 2022,2024 <dev@brigid.jp>
+// Copyright (c) 2022,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -14,15 +14,16 @@
 #include <lua.hpp>
 
 #include <exception>
+#include <vector>
 
 namespace brigid {
   namespace {
     
-#line 22 "hasher.cxx"
+#line 23 "hasher.cxx"
 static const int hasher_name_chooser_start = 1;
 
 
-#line 30 "hasher.rl"
+#line 31 "hasher.rl"
 
 
 #ifdef __GNUC__
@@ -33,16 +34,16 @@ static const int hasher_name_chooser_start = 1;
     hasher* new_hasher(lua_State* L, const char* name) {
       int cs = 0;
       
-#line 37 "hasher.cxx"
+#line 38 "hasher.cxx"
 	{
 	cs = hasher_name_chooser_start;
 	}
 
-#line 40 "hasher.rl"
+#line 41 "hasher.rl"
       const char* p = name;
       const char* pe = nullptr;
       
-#line 46 "hasher.cxx"
+#line 47 "hasher.cxx"
 	{
 	if ( p == pe )
 		goto _test_eof;
@@ -87,22 +88,22 @@ case 5:
 		goto tr7;
 	goto st0;
 tr7:
-#line 23 "hasher.rl"
+#line 24 "hasher.rl"
 	{ return new_sha1_hasher(L); }
 	goto st12;
 tr10:
-#line 25 "hasher.rl"
+#line 26 "hasher.rl"
 	{ return new_sha256_hasher(L); }
 	goto st12;
 tr13:
-#line 27 "hasher.rl"
+#line 28 "hasher.rl"
 	{ return new_sha512_hasher(L); }
 	goto st12;
 st12:
 	if ( ++p == pe )
 		goto _test_eof12;
 case 12:
-#line 106 "hasher.cxx"
+#line 107 "hasher.cxx"
 	goto st0;
 st6:
 	if ( ++p == pe )
@@ -163,7 +164,7 @@ case 11:
 	_out: {}
 	}
 
-#line 43 "hasher.rl"
+#line 44 "hasher.rl"
       return nullptr;
     }
 
@@ -189,8 +190,11 @@ case 11:
 
     void impl_update(lua_State* L) {
       hasher* self = check_hasher(L, 1);
-      data_t source = check_data(L, 2);
-      self->update(source.data(), source.size());
+      std::vector<data_t> segments;
+      check_data_segments(L, 2, segments);
+      for (size_t i = 0; i < segments.size(); ++i) {
+        self->update(segments[i].data(), segments[i].size());
+      }
     }
 
     void impl_digest(lua_State* L) {
@@ -1,6 +1,6 @@
 // vim: syntax=ragel:
 
-// Copyright (c) 2022,2024 <dev@brigid.jp>
+// Copyright (c) 2022,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -12,6 +12,7 @@
 #include <lua.hpp>
 
 #include <exception>
+#include <vector>
 
 namespace brigid {
   namespace {
@@ -65,8 +66,11 @@ namespace brigid {
 
     void impl_update(lua_State* L) {
       hasher* self = check_hasher(L, 1);
-      data_t source = check_data(L, 2);
-      self->update(source.data(), source.size());
+      std::vector<data_t> segments;
+      check_data_segments(L, 2, segments);
+      for (size_t i = 0; i < segments.size(); ++i) {
+        self->update(segments[i].data(), segments[i].size());
+      }
     }
 
     void impl_digest(lua_State* L) {
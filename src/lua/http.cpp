@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019-2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -12,6 +12,7 @@
 #include "stack_guard.hpp"
 #include "thread_reference.hpp"
 #include "view.hpp"
+#include "writer.hpp"
 
 #include <lua.hpp>
 
@@ -47,7 +48,17 @@ namespace brigid {
           progress_cb_(progress_cb),
           header_cb_(header_cb),
           write_cb_(write_cb),
-          running_() {}
+          writer_(),
+          running_() {
+        if (write_cb_) {
+          // The body is appended to the writer without calling back to Lua.
+          lua_State* L = ref_.get();
+          writer_ = to_writer_data_writer(L, write_cb_);
+          if (!writer_) {
+            writer_ = to_writer_file_writer(L, write_cb_);
+          }
+        }
+      }
 
       bool request(
           const std::string& method,
@@ -77,6 +88,7 @@ namespace brigid {
       int progress_cb_;
       int header_cb_;
       int write_cb_;
+      writer_t* writer_;
       bool running_;
 
       bool progress_cb(size_t now, size_t total) {
@@ -129,7 +141,12 @@ namespace brigid {
       }
 
       bool write_cb(const char* data, size_t size) {
-        if (write_cb_) {
+        if (writer_) {
+          if (writer_->closed()) {
+            throw BRIGID_LOGIC_ERROR("attempt to use a closed brigid.writer");
+          }
+          writer_->write(data, size);
+        } else if (write_cb_) {
           if (lua_State* L = ref_.get()) {
             stack_guard guard(L);
             lua_pushvalue(L, write_cb_);
@@ -329,7 +346,7 @@ namespace brigid {
       lua_pop(L, 1);
 
       decltype(function<impl_call>())::set_metafield(L, -1, "__call");
-      decltype(function<impl_request>())::set_field(L, -1, "request");
+      decltype(memory_function<impl_request>())::set_field(L, -1, "request");
       decltype(function<impl_close>())::set_field(L, -1, "close");
     }
     lua_setfield(L, -2, "http_session");
@@ -1,4 +1,4 @@
-# Copyright (c) 2021,2024 <dev@brigid.jp>
+# Copyright (c) 2021,2024,2026 <dev@brigid.jp>
 # This software is released under the MIT License.
 # https://opensource.org/licenses/mit-license.php
 
@@ -14,6 +14,8 @@ CPPFLAGS = "-I$(LUA_INCDIR)" "-I$(JAVA_HOME)/include" "-I$(JAVA_HOME)/include/$(
 CXXFLAGS = -Wall -W -Wno-missing-field-initializers -std=c++11 $(CFLAGS)
 
 OBJS = \
+	buffer_pool.o \
+	cbor.o \
 	common.o \
 	common_java.o \
 	crypto.o \
@@ -30,8 +32,21 @@ OBJS = \
 	http_impl.o \
 	http_java.o \
 	json.o \
+	json_columns.o \
+	json_compile.o \
+	json_document.o \
+	json_encoder.o \
+	json_format.o \
+	json_lines.o \
 	json_parse.o \
+	json_parser.o \
+	json_projection.o \
+	json_raw.o \
+	json_tape.o \
+	memory.o \
 	module.o \
+	msgpack.o \
+	number.o \
 	new_decryptor.o \
 	new_encryptor.o \
 	scope_exit.o \
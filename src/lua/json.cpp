@@ -1,4 +1,4 @@
-// Copyright (c) 2021 <dev@brigid.jp>
+// Copyright (c) 2021,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -15,7 +15,15 @@ namespace brigid {
     }
   }
 
+  void initialize_json_columns(lua_State*);
+  void initialize_json_compile(lua_State*);
+  void initialize_json_document(lua_State*);
+  void initialize_json_encoder(lua_State*);
+  void initialize_json_format(lua_State*);
+  void initialize_json_lines(lua_State*);
   void initialize_json_parse(lua_State*);
+  void initialize_json_parser(lua_State*);
+  void initialize_json_raw(lua_State*);
 
   void initialize_json(lua_State* L) {
     new_metatable(L, "brigid.json.array");
@@ -29,7 +37,15 @@ namespace brigid {
     {
       decltype(function<impl_array>())::set_field(L, -1, "array");
 
+      initialize_json_columns(L);
+      initialize_json_compile(L);
+      initialize_json_document(L);
+      initialize_json_encoder(L);
+      initialize_json_format(L);
+      initialize_json_lines(L);
       initialize_json_parse(L);
+      initialize_json_parser(L);
+      initialize_json_raw(L);
     }
     lua_setfield(L, -2, "json");
   }
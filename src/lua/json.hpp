@@ -0,0 +1,160 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_JSON_HPP
+#define BRIGID_JSON_HPP
+
+#include "view.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace brigid {
+  // The maximum number of nested objects and arrays.
+  static const size_t json_max_depth = 1024;
+
+  enum json_type_t {
+    json_null,
+    json_false,
+    json_true,
+    json_number,
+    json_string,
+    json_object,
+    json_array,
+  };
+
+  // The machine of parse_json calls the handler for each token. A member or
+  // an element is reported after its value. The strings are passed as they
+  // are in the source if they have no escape sequences. Otherwise, ps is the
+  // opening quote (or null if the string is continued from the previous
+  // chunk) and pe is next to the closing quote, and the decoded bytes are in
+  // buffer. number returns false if the token cannot be converted.
+  class json_handler_t {
+  public:
+    virtual ~json_handler_t() {}
+    virtual void literal(json_type_t) = 0;
+    virtual bool number(const char*, size_t, bool is_int, bool terminated) = 0;
+    virtual void string(const char* ps, const char* pe) = 0;
+    virtual void escaped_string(const char* ps, const char* pe, const std::vector<char>& buffer) = 0;
+    virtual void begin_object() = 0;
+    virtual void end_object() = 0;
+    virtual void begin_array() = 0;
+    virtual void end_array() = 0;
+    virtual void member() = 0;
+    virtual void element() = 0;
+  };
+
+  struct json_parse_state_t {
+    json_parse_state_t()
+      : cs(),
+        top(),
+        base(),
+        token(),
+        is_int(),
+        u(),
+        position(),
+        view_threshold() {}
+
+    std::vector<int> stack;
+    std::vector<char> buffer;
+    std::vector<int> array_stack;
+
+    // The machine is suspended at the end of a chunk of a stream. The bytes
+    // of the token which is continued to the next chunk are kept in carry.
+    // The values being built are kept on the Lua stack above base.
+    int cs;
+    int top;
+    int base;
+    bool token;
+    bool is_int;
+    uint32_t u;
+    size_t position;
+    std::vector<char> carry;
+
+    // If view_threshold is not zero, unescaped strings of at least
+    // view_threshold bytes are pushed as views into the source which
+    // view_ref keeps alive.
+    size_t view_threshold;
+    std::shared_ptr<view_reference_t> view_ref;
+  };
+
+  // Creates the Lua values on the stack. The value of a member or an
+  // element is set to the table under it.
+  class json_value_handler_t final : public json_handler_t {
+  public:
+    json_value_handler_t(lua_State*, int, int, json_parse_state_t&);
+    virtual void literal(json_type_t);
+    virtual bool number(const char*, size_t, bool, bool);
+    virtual void string(const char*, const char*);
+    virtual void escaped_string(const char*, const char*, const std::vector<char>&);
+    virtual void begin_object();
+    virtual void end_object();
+    virtual void begin_array();
+    virtual void end_array();
+    virtual void member();
+    virtual void element();
+  private:
+    lua_State* L_;
+    int null_index_;
+    int array_index_;
+    json_parse_state_t& state_;
+  };
+
+  bool parse_json_number(const char*, size_t, bool, bool&, lua_Integer&, double&, std::vector<char>&);
+  void parse_json(lua_State*, const char*, size_t, int, int, json_parse_state_t&);
+  void parse_json(json_handler_t&, const char*, size_t);
+  bool parse_json_stream(lua_State*, const char*&, const char*, bool, int, int, json_parse_state_t&);
+  void push_json_unescaped(lua_State*, const char*, size_t, json_parse_state_t&);
+  void validate_json(const char*, size_t);
+
+  // A tape is the preorder sequence of the nodes of a JSON text. A member of
+  // an object is stored as a string node of the key followed by the nodes of
+  // the value. The strings with escape sequences are decoded into the
+  // strings of the tape when it is built.
+  struct json_node_t {
+    json_type_t type;
+    bool escaped;  // string is in the strings instead of the source
+    bool is_int;   // number is integer
+    size_t offset; // position of the number or the contents of the string
+    size_t size;   // size of the number or the contents of the string
+    size_t end;    // index of the node next to the last descendant
+    size_t count;  // number of members or elements
+  };
+
+  inline const char* get_json_string(const char* data, const char* strings, const json_node_t& node) {
+    return (node.escaped ? strings : data) + node.offset;
+  }
+
+  void parse_json_tape(const char*, size_t, std::vector<json_node_t>&, std::vector<char>&);
+  void append_json_tape(const char*, size_t, std::vector<json_node_t>&, std::vector<char>&);
+  void push_json_string(lua_State*, const char*, const char*, const json_node_t&);
+  void push_json_tape(lua_State*, const char*, const char*, const std::vector<json_node_t>&, size_t, int, int, json_parse_state_t&);
+
+  // A projection is a tree of the dot-separated key paths to keep. The root
+  // is at index 0.
+  class json_projection_t {
+  public:
+    json_projection_t();
+    void add(const char*, size_t);
+    size_t find(size_t, const char*, size_t) const;
+    bool all(size_t) const;
+    bool empty() const;
+  private:
+    struct node_t {
+      size_t parent;
+      std::string key;
+      bool all;
+    };
+    std::vector<node_t> nodes_;
+  };
+
+  void push_json_projection(lua_State*, const char*, const char*, const std::vector<json_node_t>&, size_t, const json_projection_t&, size_t, int, int, json_parse_state_t&);
+}
+
+#endif
@@ -0,0 +1,321 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "writer.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <string.h>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    static const size_t npos = static_cast<size_t>(-1);
+
+    size_t find_column(const std::vector<std::string>& keys, const char* key, size_t size) {
+      for (size_t i = 0; i < keys.size(); ++i) {
+        const std::string& k = keys[i];
+        if (k.size() == size && memcmp(k.data(), key, size) == 0) {
+          return i;
+        }
+      }
+      return npos;
+    }
+
+    // Stores the members of the rows into the columns while the source is
+    // parsed, so that neither a tape nor a table of a row is created. The
+    // columns are on the Lua stack from base + 1. The tokens of a stored
+    // value are forwarded to the value handler. A column of doubles is a
+    // writer, to which the value of each row is appended at the end of the
+    // row.
+    class json_columns_builder_t : public json_handler_t {
+    public:
+      json_columns_builder_t(lua_State* L, const std::vector<std::string>& keys, const std::vector<writer_t*>& writers, int base, int null_index, int array_index)
+        : L_(L),
+          keys_(keys),
+          writers_(writers),
+          base_(base),
+          null_index_(null_index),
+          value_(L, null_index, array_index, state_),
+          depth_(),
+          key_(),
+          row_(),
+          column_(npos),
+          rows_(keys.size()),
+          values_(keys.size()) {}
+
+      lua_Integer rows() const {
+        return row_;
+      }
+
+      virtual void literal(json_type_t type) {
+        if (forward()) {
+          value_.literal(type);
+        } else if (double_column()) {
+          if (type != json_null) {
+            not_a_number();
+          }
+          set_double(std::numeric_limits<double>::quiet_NaN());
+        } else {
+          check_row();
+        }
+      }
+
+      virtual bool number(const char* data, size_t size, bool is_int, bool terminated) {
+        if (forward()) {
+          return value_.number(data, size, is_int, terminated);
+        }
+        if (double_column()) {
+          lua_Integer integer = 0;
+          double number = 0;
+          if (!parse_json_number(data, size, terminated, is_int, integer, number, state_.buffer)) {
+            return false;
+          }
+          set_double(is_int ? static_cast<double>(integer) : number);
+        } else {
+          check_row();
+        }
+        return true;
+      }
+
+      virtual void string(const char* ps, const char* pe) {
+        if (depth_ == 2 && key_) {
+          set_key(ps, pe - ps);
+        } else if (forward()) {
+          value_.string(ps, pe);
+        } else if (double_column()) {
+          not_a_number();
+        } else {
+          check_row();
+        }
+      }
+
+      virtual void escaped_string(const char* ps, const char* pe, const std::vector<char>& buffer) {
+        if (depth_ == 2 && key_) {
+          set_key(buffer.data(), buffer.size());
+        } else if (forward()) {
+          value_.escaped_string(ps, pe, buffer);
+        } else if (double_column()) {
+          not_a_number();
+        } else {
+          check_row();
+        }
+      }
+
+      virtual void begin_object() {
+        if (depth_ == 0) {
+          throw BRIGID_RUNTIME_ERROR("not an array");
+        }
+        if (depth_ == 1) {
+          ++row_;
+          key_ = true;
+        } else if (forward()) {
+          value_.begin_object();
+        } else if (double_column()) {
+          not_a_number();
+        }
+        ++depth_;
+      }
+
+      virtual void end_object() {
+        if (--depth_ == 1) {
+          finish_row();
+        } else if (forward()) {
+          value_.end_object();
+        }
+      }
+
+      virtual void begin_array() {
+        if (depth_ == 1) {
+          not_an_object();
+        }
+        if (forward()) {
+          value_.begin_array();
+        } else if (double_column()) {
+          not_a_number();
+        }
+        ++depth_;
+      }
+
+      virtual void end_array() {
+        if (--depth_ >= 2 && forward()) {
+          value_.end_array();
+        }
+      }
+
+      // A duplicate member overwrites the previous one.
+      virtual void member() {
+        if (depth_ > 2) {
+          if (forward()) {
+            value_.member();
+          }
+        } else {
+          if (column_ != npos && !writers_[column_]) {
+            rows_[column_] = row_;
+            lua_rawseti(L_, base_ + 1 + static_cast<int>(column_), row_);
+          }
+          column_ = npos;
+          key_ = true;
+        }
+      }
+
+      virtual void element() {
+        if (depth_ > 2 && forward()) {
+          value_.element();
+        }
+      }
+
+    private:
+      lua_State* L_;
+      const std::vector<std::string>& keys_;
+      const std::vector<writer_t*>& writers_;
+      int base_;
+      int null_index_;
+      json_parse_state_t state_;
+      json_value_handler_t value_;
+      size_t depth_;
+      bool key_;
+      lua_Integer row_;
+      size_t column_;
+      std::vector<lua_Integer> rows_;
+      std::vector<double> values_;
+
+      [[noreturn]] void not_an_object() {
+        std::ostringstream out;
+        out << "not an object at row " << (row_ + 1);
+        throw BRIGID_RUNTIME_ERROR(out.str());
+      }
+
+      [[noreturn]] void not_a_number() {
+        std::ostringstream out;
+        out << "not a number at row " << row_;
+        throw BRIGID_RUNTIME_ERROR(out.str());
+      }
+
+      // A scalar out of the rows.
+      void check_row() {
+        if (depth_ == 0) {
+          throw BRIGID_RUNTIME_ERROR("not an array");
+        }
+        if (depth_ == 1) {
+          not_an_object();
+        }
+      }
+
+      // The value of a stored column of Lua values, or of its descendants.
+      bool forward() const {
+        return depth_ >= 2 && column_ != npos && !writers_[column_];
+      }
+
+      bool double_column() const {
+        return depth_ == 2 && column_ != npos && writers_[column_];
+      }
+
+      void set_key(const char* key, size_t size) {
+        column_ = find_column(keys_, key, size);
+        key_ = false;
+      }
+
+      void set_double(double value) {
+        rows_[column_] = row_;
+        values_[column_] = value;
+      }
+
+      void finish_row() {
+        for (size_t j = 0; j < keys_.size(); ++j) {
+          if (writer_t* writer = writers_[j]) {
+            double value = rows_[j] == row_ ? values_[j] : std::numeric_limits<double>::quiet_NaN();
+            writer->write(reinterpret_cast<const char*>(&value), sizeof(value));
+          } else if (rows_[j] != row_ && null_index_) {
+            lua_pushvalue(L_, null_index_);
+            lua_rawseti(L_, base_ + 1 + static_cast<int>(j), row_);
+          }
+        }
+        column_ = npos;
+      }
+    };
+
+    void check_keys(lua_State* L, int index, std::vector<std::string>& keys) {
+      index = abs_index(L, index);
+      for (int i = 1; ; ++i) {
+        lua_rawgeti(L, index, i);
+        size_t size = 0;
+        const char* key = lua_tolstring(L, -1, &size);
+        lua_pop(L, 1);
+        if (!key) {
+          break;
+        }
+        keys.emplace_back(key, size);
+      }
+    }
+
+    // Decodes an array of objects into one array per key. The source is read
+    // in a single pass, and no table is created for the rows. A missing
+    // member is stored as the null value.
+    //
+    // The columns named in options.doubles are returned as data_writers of
+    // packed native doubles, which can be read by FFI. A missing member and
+    // null are stored as NaN.
+    int impl_parse_columns(lua_State* L) {
+      data_t data = check_data(L, 1);
+      luaL_checktype(L, 2, LUA_TTABLE);
+      int null_index = lua_isnoneornil(L, 3) ? 0 : 3;
+
+      std::vector<std::string> keys;
+      check_keys(L, 2, keys);
+
+      std::vector<std::string> doubles;
+      if (!lua_isnoneornil(L, 4)) {
+        if (get_field(L, 4, "doubles") != LUA_TNIL) {
+          luaL_checktype(L, -1, LUA_TTABLE);
+          check_keys(L, -1, doubles);
+        }
+        lua_pop(L, 1);
+      }
+
+      int n = static_cast<int>(keys.size());
+      lua_checkstack(L, n + 8);
+      luaL_getmetatable(L, "brigid.json.array");
+      int array_index = lua_gettop(L);
+      int base = array_index;
+      std::vector<writer_t*> writers(n);
+      for (int j = 0; j < n; ++j) {
+        const std::string& key = keys[j];
+        if (find_column(doubles, key.data(), key.size()) != npos) {
+          writers[j] = new_data_writer(L);
+        } else {
+          lua_newtable(L);
+          lua_pushvalue(L, array_index);
+          lua_setmetatable(L, -2);
+        }
+      }
+
+      json_columns_builder_t builder(L, keys, writers, base, null_index, array_index);
+      parse_json(builder, data.data(), data.size());
+
+      lua_createtable(L, 0, n);
+      for (int j = 0; j < n; ++j) {
+        const std::string& key = keys[j];
+        lua_pushlstring(L, key.data(), key.size());
+        lua_pushvalue(L, base + 1 + j);
+        lua_rawset(L, -3);
+      }
+      push_integer(L, builder.rows());
+      return 2;
+    }
+  }
+
+  void initialize_json_columns(lua_State* L) {
+    decltype(memory_function<impl_parse_columns>())::set_field(L, -1, "parse_columns");
+  }
+}
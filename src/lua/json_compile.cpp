@@ -0,0 +1,271 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "noncopyable.hpp"
+#include "writer.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    enum json_field_type_t {
+      json_field_any,
+      json_field_boolean,
+      json_field_number,
+      json_field_string,
+      json_field_object,
+    };
+
+    // Escapes the keys at compile time. The window is the unused capacity
+    // of the string, which is trimmed by the destructor.
+    class string_writer_t : public writer_t {
+    public:
+      explicit string_writer_t(std::string& buffer)
+        : buffer_(buffer),
+          size_(buffer.size()) {}
+
+      ~string_writer_t() {
+        buffer_.resize(size());
+      }
+
+      virtual bool closed() const {
+        return false;
+      }
+
+    private:
+      std::string& buffer_;
+      size_t size_;
+
+      size_t size() const {
+        return cursor_ ? cursor_ - &buffer_[0] : size_;
+      }
+
+      virtual void refill(const char* data, size_t size) {
+        expand(size);
+        memcpy(cursor_, data, size);
+        cursor_ += size;
+      }
+
+      virtual void expand(size_t n) {
+        size_t size = this->size();
+        buffer_.resize(std::max(std::max<size_t>(buffer_.size() * 2, 64), size + n));
+        cursor_ = &buffer_[0] + size;
+        limit_ = &buffer_[0] + buffer_.size();
+      }
+    };
+
+    // A field of an object schema. The fields of a nested object follow its
+    // field in preorder, and end is the index next to the last descendant.
+    // The prefix is the escaped key with the separator, such as ',"key":'.
+    struct json_field_t {
+      std::string key;
+      std::string prefix;
+      json_field_type_t type;
+      size_t end;
+    };
+
+    // An encoder specialized for a schema. The members are written in the
+    // order of the schema without looking at the shape of the tables, and a
+    // missing member is written as null.
+    class json_schema_t : private noncopyable {
+    public:
+      void compile(lua_State* L, int index) {
+        compile_object(L, index);
+      }
+
+      void write(lua_State* L, writer_t* writer, int index) const {
+        write_object(L, writer, index, 0, fields_.size());
+      }
+
+    private:
+      std::vector<json_field_t> fields_;
+
+      [[noreturn]] static void error(const json_field_t& field, const char* what) {
+        std::ostringstream out;
+        out << "field " << field.key << ": " << what;
+        throw BRIGID_LOGIC_ERROR(out.str());
+      }
+
+      // A field is a key, or a pair of a key and a type name or a nested
+      // schema.
+      void compile_object(lua_State* L, int index) {
+        index = abs_index(L, index);
+        lua_checkstack(L, 4);
+        for (int i = 1; ; ++i) {
+          lua_rawgeti(L, index, i);
+          if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            break;
+          }
+
+          json_field_t field = { std::string(), std::string(i == 1 ? "" : ","), json_field_any, 0 };
+          bool nested = false;
+          if (lua_istable(L, -1)) {
+            lua_rawgeti(L, -1, 1);
+            lua_rawgeti(L, -2, 2);
+            lua_remove(L, -3);
+            if (lua_istable(L, -1)) {
+              nested = true;
+              field.type = json_field_object;
+            } else if (!lua_isnil(L, -1)) {
+              field.type = check_type(L, -1);
+            }
+            lua_insert(L, -2);
+          } else {
+            lua_pushnil(L);
+            lua_insert(L, -2);
+          }
+
+          // Checked before to_data, which converts a number in place.
+          if (lua_type(L, -1) != LUA_TSTRING) {
+            throw BRIGID_LOGIC_ERROR("string expected for the key of a field");
+          }
+          data_t key = to_data(L, -1);
+          field.key.assign(key.data(), key.size());
+          {
+            string_writer_t writer(field.prefix);
+            write_json_string(&writer, key.data(), key.size());
+            writer.write(':');
+          }
+          lua_pop(L, 1);
+
+          size_t position = fields_.size();
+          fields_.push_back(field);
+          if (nested) {
+            compile_object(L, -1);
+          }
+          fields_[position].end = fields_.size();
+          lua_pop(L, 1);
+        }
+      }
+
+      static json_field_type_t check_type(lua_State* L, int index) {
+        const char* name = lua_tostring(L, index);
+        if (name) {
+          if (strcmp(name, "any") == 0) {
+            return json_field_any;
+          } else if (strcmp(name, "boolean") == 0) {
+            return json_field_boolean;
+          } else if (strcmp(name, "number") == 0) {
+            return json_field_number;
+          } else if (strcmp(name, "string") == 0) {
+            return json_field_string;
+          }
+        }
+        throw BRIGID_LOGIC_ERROR("unknown field type");
+      }
+
+      void write_object(lua_State* L, writer_t* writer, int index, size_t begin, size_t end) const {
+        lua_checkstack(L, 2);
+        writer->write('{');
+        for (size_t i = begin; i < end; i = fields_[i].end) {
+          const json_field_t& field = fields_[i];
+          writer->write(field.prefix.data(), field.prefix.size());
+          lua_pushlstring(L, field.key.data(), field.key.size());
+          lua_rawget(L, index);
+          write_field(L, writer, i);
+          lua_pop(L, 1);
+        }
+        writer->write('}');
+      }
+
+      // Writes the value on the top of the stack.
+      void write_field(lua_State* L, writer_t* writer, size_t i) const {
+        const json_field_t& field = fields_[i];
+        int type = lua_type(L, -1);
+        if (type == LUA_TNIL) {
+          writer->write("null", 4);
+          return;
+        }
+
+        switch (field.type) {
+          case json_field_any:
+            write_json(L, writer, lua_gettop(L), 0, 0, false);
+            return;
+          case json_field_boolean:
+            if (type != LUA_TBOOLEAN) {
+              error(field, "boolean expected");
+            }
+            if (lua_toboolean(L, -1)) {
+              writer->write("true", 4);
+            } else {
+              writer->write("false", 5);
+            }
+            return;
+          case json_field_number:
+            if (type != LUA_TNUMBER) {
+              error(field, "number expected");
+            }
+            write_json_number(L, writer, lua_gettop(L));
+            return;
+          case json_field_string:
+            if (type != LUA_TSTRING) {
+              error(field, "string expected");
+            }
+            {
+              size_t size = 0;
+              const char* data = lua_tolstring(L, -1, &size);
+              write_json_string(writer, data, size);
+            }
+            return;
+          case json_field_object:
+            if (type != LUA_TTABLE) {
+              error(field, "table expected");
+            }
+            write_object(L, writer, lua_gettop(L), i + 1, field.end);
+            return;
+        }
+      }
+    };
+
+    json_schema_t* check_json_schema(lua_State* L, int arg) {
+      return check_udata<json_schema_t>(L, arg, "brigid.json.schema");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_json_schema(L, 1)->~json_schema_t();
+    }
+
+    void impl_write(lua_State* L) {
+      json_schema_t* self = check_json_schema(L, 1);
+      writer_t* writer = check_writer(L, 2);
+      luaL_checktype(L, 3, LUA_TTABLE);
+      self->write(L, writer, 3);
+      lua_pushvalue(L, 2);
+    }
+
+    void impl_compile(lua_State* L) {
+      luaL_checktype(L, 1, LUA_TTABLE);
+      json_schema_t* self = new_userdata<json_schema_t>(L, "brigid.json.schema");
+      self->compile(L, 1);
+    }
+  }
+
+  void initialize_json_compile(lua_State* L) {
+    lua_newtable(L);
+    {
+      new_metatable(L, "brigid.json.schema");
+      lua_pushvalue(L, -2);
+      lua_setfield(L, -2, "__index");
+      decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+      lua_pop(L, 1);
+
+      decltype(memory_function<impl_write>())::set_field(L, -1, "write");
+    }
+    lua_pop(L, 1);
+
+    decltype(function<impl_compile>())::set_field(L, -1, "compile");
+  }
+}
@@ -0,0 +1,343 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+#include "thread_reference.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <string.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // The tape keeps a reference to the source string, or a copy of the
+    // source if it is not a string. The reference thread holds the source at
+    // index 1 and the null value at index 2.
+    class json_tape_t : private noncopyable {
+    public:
+      json_tape_t(thread_reference&& ref, bool has_null)
+        : ref_(std::move(ref)),
+          has_null_(has_null),
+          data_() {}
+
+      void parse(const char* data, size_t size, bool copy) {
+        if (copy) {
+          source_.assign(data, data + size);
+          data = source_.data();
+        }
+        data_ = data;
+        parse_json_tape(data, size, nodes_, strings_);
+      }
+
+      const char* data() const {
+        return data_;
+      }
+
+      const char* strings() const {
+        return strings_.data();
+      }
+
+      const std::vector<json_node_t>& nodes() const {
+        return nodes_;
+      }
+
+      const json_node_t& node(size_t index) const {
+        return nodes_[index];
+      }
+
+      // Pushes the null value and returns its index, or returns 0 if the
+      // null value is not specified.
+      int push_null(lua_State* L) const {
+        if (!has_null_) {
+          return 0;
+        }
+        lua_State* thread = ref_.get();
+        lua_pushvalue(thread, 2);
+        lua_xmove(thread, L, 1);
+        return lua_gettop(L);
+      }
+
+      size_t find_member(size_t index, const char* key, size_t size) const {
+        const json_node_t& node = nodes_[index];
+        if (node.type != json_object) {
+          return npos;
+        }
+        size_t result = npos;
+        for (size_t i = index + 1; i < node.end; i = nodes_[i + 1].end) {
+          const json_node_t& k = nodes_[i];
+          if (k.size == size && memcmp(get_json_string(data_, strings_.data(), k), key, size) == 0) {
+            result = i + 1;
+          }
+        }
+        return result;
+      }
+
+      size_t find_element(size_t index, size_t position) const {
+        const json_node_t& node = nodes_[index];
+        if (node.type != json_array || position < 1 || position > node.count) {
+          return npos;
+        }
+        size_t i = index + 1;
+        for (; position > 1; --position) {
+          i = nodes_[i].end;
+        }
+        return i;
+      }
+
+      // Resolves a path such as "a.b[3]" relative to the node at index. The
+      // names are separated by '.' and the 1-based array indices are
+      // enclosed in brackets.
+      size_t resolve(size_t index, const char* path, size_t size) const {
+        const char* p = path;
+        const char* const pe = p + size;
+        bool first = true;
+        while (p != pe) {
+          if (*p == '[') {
+            size_t position = 0;
+            const char* ps = ++p;
+            for (; p != pe && '0' <= *p && *p <= '9'; ++p) {
+              position = position * 10 + *p - '0';
+            }
+            if (p == ps || p == pe || *p != ']') {
+              throw BRIGID_LOGIC_ERROR("invalid path");
+            }
+            ++p;
+            if (index != npos) {
+              index = find_element(index, position);
+            }
+          } else {
+            if (!first) {
+              if (*p != '.') {
+                throw BRIGID_LOGIC_ERROR("invalid path");
+              }
+              ++p;
+            }
+            const char* ps = p;
+            while (p != pe && *p != '.' && *p != '[') {
+              ++p;
+            }
+            if (index != npos) {
+              index = find_member(index, ps, p - ps);
+            }
+          }
+          first = false;
+        }
+        return index;
+      }
+
+    private:
+      thread_reference ref_;
+      bool has_null_;
+      const char* data_;
+      std::vector<char> source_;
+      std::vector<json_node_t> nodes_;
+      std::vector<char> strings_;
+    };
+
+    // A document refers to a node of a shared tape. It also works as the
+    // state of the iterator returned by each.
+    class json_document_t : private noncopyable {
+    public:
+      json_document_t(const std::shared_ptr<json_tape_t>& tape, size_t index)
+        : tape_(tape),
+          index_(index),
+          cursor_(index + 1),
+          position_() {}
+
+      const std::shared_ptr<json_tape_t>& tape() const {
+        return tape_;
+      }
+
+      size_t index() const {
+        return index_;
+      }
+
+      const json_node_t& node() const {
+        return tape_->node(index_);
+      }
+
+      size_t resolve(lua_State* L, int arg) {
+        size_t size = 0;
+        const char* path = luaL_optlstring(L, arg, "", &size);
+        return tape_->resolve(index_, path, size);
+      }
+
+      void push(lua_State* L, size_t index) {
+        const json_node_t& node = tape_->node(index);
+        if (node.type == json_object || node.type == json_array) {
+          new_userdata<json_document_t>(L, "brigid.json.document", tape_, index);
+        } else {
+          materialize(L, index);
+        }
+      }
+
+      void materialize(lua_State* L, size_t index) {
+        int top = lua_gettop(L);
+        int null_index = tape_->push_null(L);
+        luaL_getmetatable(L, "brigid.json.array");
+        int array_index = lua_gettop(L);
+        push_json_tape(L, tape_->data(), tape_->strings(), tape_->nodes(), index, null_index, array_index, state_);
+        lua_replace(L, top + 1);
+        lua_settop(L, top + 1);
+      }
+
+      void finish() {
+        cursor_ = node().end;
+      }
+
+      // Pushes the next key and value, or returns false if the iteration is
+      // finished.
+      bool next(lua_State* L) {
+        const json_node_t& node = this->node();
+        if (cursor_ >= node.end) {
+          return false;
+        }
+        if (node.type == json_object) {
+          push_json_string(L, tape_->data(), tape_->strings(), tape_->node(cursor_));
+          push(L, cursor_ + 1);
+          cursor_ = tape_->node(cursor_ + 1).end;
+        } else {
+          push_integer(L, ++position_);
+          push(L, cursor_);
+          cursor_ = tape_->node(cursor_).end;
+        }
+        return true;
+      }
+
+    private:
+      std::shared_ptr<json_tape_t> tape_;
+      size_t index_;
+      size_t cursor_;
+      size_t position_;
+      json_parse_state_t state_;
+    };
+
+    json_document_t* check_json_document(lua_State* L, int arg) {
+      return check_udata<json_document_t>(L, arg, "brigid.json.document");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_json_document(L, 1)->~json_document_t();
+    }
+
+    void impl_call(lua_State* L) {
+      data_t data = check_data(L, 2);
+      bool copy = lua_type(L, 2) != LUA_TSTRING;
+      bool has_null = lua_gettop(L) >= 3;
+
+      thread_reference ref(L);
+      if (copy) {
+        lua_pushnil(ref.get());
+      } else {
+        lua_pushvalue(L, 2);
+        lua_xmove(L, ref.get(), 1);
+      }
+      if (has_null) {
+        lua_pushvalue(L, 3);
+        lua_xmove(L, ref.get(), 1);
+      }
+
+      std::shared_ptr<json_tape_t> tape = std::make_shared<json_tape_t>(std::move(ref), has_null);
+      tape->parse(data.data(), data.size(), copy);
+      new_userdata<json_document_t>(L, "brigid.json.document", tape, 0);
+    }
+
+    void impl_get(lua_State* L) {
+      json_document_t* self = check_json_document(L, 1);
+      size_t index = self->resolve(L, 2);
+      if (index == npos) {
+        lua_pushnil(L);
+      } else {
+        self->push(L, index);
+      }
+    }
+
+    void impl_materialize(lua_State* L) {
+      json_document_t* self = check_json_document(L, 1);
+      size_t index = self->resolve(L, 2);
+      if (index == npos) {
+        lua_pushnil(L);
+      } else {
+        self->materialize(L, index);
+      }
+    }
+
+    void impl_type(lua_State* L) {
+      static const char* names[] = { "null", "boolean", "boolean", "number", "string", "object", "array" };
+      json_document_t* self = check_json_document(L, 1);
+      size_t index = self->resolve(L, 2);
+      if (index == npos) {
+        lua_pushnil(L);
+      } else {
+        lua_pushstring(L, names[self->tape()->node(index).type]);
+      }
+    }
+
+    // Lua passes the operand again as the second argument of __len.
+    void impl_len(lua_State* L) {
+      json_document_t* self = check_json_document(L, 1);
+      push_integer(L, self->node().count);
+    }
+
+    void impl_get_size(lua_State* L) {
+      json_document_t* self = check_json_document(L, 1);
+      size_t index = self->resolve(L, 2);
+      if (index == npos) {
+        lua_pushnil(L);
+      } else {
+        push_integer(L, self->tape()->node(index).count);
+      }
+    }
+
+    int impl_each_next(lua_State* L) {
+      json_document_t* self = check_json_document(L, 1);
+      if (self->next(L)) {
+        return 2;
+      }
+      lua_pushnil(L);
+      return 1;
+    }
+
+    void impl_each(lua_State* L) {
+      json_document_t* self = check_json_document(L, 1);
+      size_t index = self->resolve(L, 2);
+      lua_pushcfunction(L, decltype(function<impl_each_next>())::value);
+      json_document_t* state = new_userdata<json_document_t>(L, "brigid.json.document", self->tape(), index == npos ? self->index() : index);
+      if (index == npos) {
+        state->finish();
+      }
+    }
+  }
+
+  void initialize_json_document(lua_State* L) {
+    lua_newtable(L);
+    {
+      new_metatable(L, "brigid.json.document");
+      lua_pushvalue(L, -2);
+      lua_setfield(L, -2, "__index");
+      decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+      decltype(function<impl_len>())::set_field(L, -1, "__len");
+      lua_pop(L, 1);
+
+      decltype(function<impl_call>())::set_metafield(L, -1, "__call");
+      decltype(function<impl_get>())::set_field(L, -1, "get");
+      decltype(function<impl_materialize>())::set_field(L, -1, "materialize");
+      decltype(function<impl_type>())::set_field(L, -1, "type");
+      decltype(function<impl_get_size>())::set_field(L, -1, "get_size");
+      decltype(function<impl_each>())::set_field(L, -1, "each");
+    }
+    lua_setfield(L, -2, "document");
+  }
+}
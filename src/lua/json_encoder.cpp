@@ -0,0 +1,210 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+#include "thread_reference.hpp"
+#include "writer.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    // Writes a JSON text piece by piece. The encoder keeps the nesting and
+    // the separators, so that the values can be written as they are
+    // produced. The reference thread holds the writer at index 1.
+    class json_encoder_t : private noncopyable {
+    public:
+      json_encoder_t(thread_reference&& ref, int indent, bool sort_keys)
+        : ref_(std::move(ref)),
+          indent_(indent),
+          sort_keys_(sort_keys),
+          after_key_(),
+          done_() {}
+
+      void begin(json_type_t type) {
+        writer_t* writer = begin_value();
+        writer->write(type == json_object ? '{' : '[');
+        frame_t frame = { type, true };
+        stack_.push_back(frame);
+      }
+
+      void end(json_type_t type) {
+        if (stack_.empty() || stack_.back().type != type || after_key_) {
+          throw BRIGID_LOGIC_ERROR(type == json_object ? "unexpected end_object" : "unexpected end_array");
+        }
+        writer_t* writer = get_writer();
+        bool first = stack_.back().first;
+        stack_.pop_back();
+        if (!first && indent_) {
+          write_indent(writer);
+        }
+        writer->write(type == json_object ? '}' : ']');
+        end_value();
+      }
+
+      void key(const char* data, size_t size) {
+        if (stack_.empty() || stack_.back().type != json_object || after_key_) {
+          throw BRIGID_LOGIC_ERROR("unexpected key");
+        }
+        writer_t* writer = get_writer();
+        write_separator(writer);
+        write_json_string(writer, data, size);
+        writer->write(':');
+        if (indent_) {
+          writer->write(' ');
+        }
+        after_key_ = true;
+      }
+
+      void value(lua_State* L, int index) {
+        writer_t* writer = begin_value();
+        write_json(L, writer, index, indent_, static_cast<int>(stack_.size()), sort_keys_);
+        end_value();
+      }
+
+    private:
+      struct frame_t {
+        json_type_t type;
+        bool first;
+      };
+
+      thread_reference ref_;
+      int indent_;
+      bool sort_keys_;
+      std::vector<frame_t> stack_;
+      bool after_key_;
+      bool done_;
+
+      writer_t* get_writer() const {
+        writer_t* writer = to_writer(ref_.get(), 1);
+        if (writer->closed()) {
+          throw BRIGID_LOGIC_ERROR("attempt to use a closed brigid.writer");
+        }
+        return writer;
+      }
+
+      void write_indent(writer_t* writer) const {
+        writer->write('\n');
+        for (size_t i = 0; i < static_cast<size_t>(indent_) * stack_.size(); ++i) {
+          writer->write(' ');
+        }
+      }
+
+      void write_separator(writer_t* writer) {
+        frame_t& frame = stack_.back();
+        if (frame.first) {
+          frame.first = false;
+        } else {
+          writer->write(',');
+        }
+        if (indent_) {
+          write_indent(writer);
+        }
+      }
+
+      writer_t* begin_value() {
+        if (stack_.empty()) {
+          if (done_) {
+            throw BRIGID_LOGIC_ERROR("value already written");
+          }
+        } else if (stack_.back().type == json_object && !after_key_) {
+          throw BRIGID_LOGIC_ERROR("key expected");
+        }
+        writer_t* writer = get_writer();
+        if (after_key_) {
+          after_key_ = false;
+        } else if (!stack_.empty()) {
+          write_separator(writer);
+        }
+        return writer;
+      }
+
+      void end_value() {
+        if (stack_.empty()) {
+          done_ = true;
+        }
+      }
+    };
+
+    json_encoder_t* check_json_encoder(lua_State* L, int arg) {
+      return check_udata<json_encoder_t>(L, arg, "brigid.json.encoder");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_json_encoder(L, 1)->~json_encoder_t();
+    }
+
+    void impl_call(lua_State* L) {
+      check_writer(L, 2);
+      int indent = opt_integer<int>(L, 3, 0);
+      if (indent < 0) {
+        throw BRIGID_LOGIC_ERROR("out of range");
+      }
+      bool sort_keys = lua_toboolean(L, 4);
+
+      thread_reference ref(L);
+      lua_pushvalue(L, 2);
+      lua_xmove(L, ref.get(), 1);
+
+      new_userdata<json_encoder_t>(L, "brigid.json.encoder", std::move(ref), indent, sort_keys);
+    }
+
+    void impl_begin_object(lua_State* L) {
+      check_json_encoder(L, 1)->begin(json_object);
+    }
+
+    void impl_end_object(lua_State* L) {
+      check_json_encoder(L, 1)->end(json_object);
+    }
+
+    void impl_begin_array(lua_State* L) {
+      check_json_encoder(L, 1)->begin(json_array);
+    }
+
+    void impl_end_array(lua_State* L) {
+      check_json_encoder(L, 1)->end(json_array);
+    }
+
+    void impl_key(lua_State* L) {
+      json_encoder_t* self = check_json_encoder(L, 1);
+      data_t data = check_data(L, 2);
+      self->key(data.data(), data.size());
+    }
+
+    void impl_value(lua_State* L) {
+      json_encoder_t* self = check_json_encoder(L, 1);
+      luaL_checkany(L, 2);
+      self->value(L, 2);
+    }
+  }
+
+  void initialize_json_encoder(lua_State* L) {
+    lua_newtable(L);
+    {
+      new_metatable(L, "brigid.json.encoder");
+      lua_pushvalue(L, -2);
+      lua_setfield(L, -2, "__index");
+      decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+      lua_pop(L, 1);
+
+      decltype(function<impl_call>())::set_metafield(L, -1, "__call");
+      decltype(memory_function<impl_begin_object>())::set_field(L, -1, "begin_object");
+      decltype(memory_function<impl_end_object>())::set_field(L, -1, "end_object");
+      decltype(memory_function<impl_begin_array>())::set_field(L, -1, "begin_array");
+      decltype(memory_function<impl_end_array>())::set_field(L, -1, "end_array");
+      decltype(memory_function<impl_key>())::set_field(L, -1, "key");
+      decltype(memory_function<impl_value>())::set_field(L, -1, "value");
+    }
+    lua_setfield(L, -2, "encoder");
+  }
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "data.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+#include "writer.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    // Writes the tokens as they are in the source. The numbers and the
+    // escape sequences of the strings are not converted, and the order of
+    // the members is kept. Only the whitespaces are replaced.
+    class json_formatter_t : public json_handler_t, private noncopyable {
+    public:
+      json_formatter_t(writer_t* writer, int indent)
+        : writer_(writer),
+          indent_(indent),
+          depth_(),
+          first_(),
+          key_(),
+          after_key_() {}
+
+      virtual void literal(json_type_t type) {
+        begin_value();
+        switch (type) {
+          case json_false:
+            writer_->write("false", 5);
+            break;
+          case json_true:
+            writer_->write("true", 4);
+            break;
+          default:
+            writer_->write("null", 4);
+            break;
+        }
+      }
+
+      virtual bool number(const char* data, size_t size, bool, bool) {
+        begin_value();
+        writer_->write(data, size);
+        return true;
+      }
+
+      virtual void string(const char* ps, const char* pe) {
+        begin_value();
+        writer_->write('"');
+        writer_->write(ps, pe - ps);
+        writer_->write('"');
+        end_string();
+      }
+
+      virtual void escaped_string(const char* ps, const char* pe, const std::vector<char>&) {
+        begin_value();
+        writer_->write(ps, pe - ps);
+        end_string();
+      }
+
+      virtual void begin_object() {
+        open('{');
+        key_ = true;
+      }
+
+      virtual void end_object() {
+        close('}');
+      }
+
+      virtual void begin_array() {
+        open('[');
+      }
+
+      virtual void end_array() {
+        close(']');
+      }
+
+      virtual void member() {
+        key_ = true;
+      }
+
+      virtual void element() {
+        key_ = false;
+      }
+
+    private:
+      writer_t* writer_;
+      int indent_;
+      int depth_;
+      bool first_;
+      bool key_;
+      bool after_key_;
+
+      void write_indent() {
+        writer_->write('\n');
+        for (int i = 0; i < indent_ * depth_; ++i) {
+          writer_->write(' ');
+        }
+      }
+
+      void begin_value() {
+        if (after_key_) {
+          after_key_ = false;
+          return;
+        }
+        if (depth_ > 0) {
+          if (!first_) {
+            writer_->write(',');
+          }
+          if (indent_) {
+            write_indent();
+          }
+          first_ = false;
+        }
+      }
+
+      // The string next to '{' or a member is a key.
+      void end_string() {
+        if (key_) {
+          key_ = false;
+          writer_->write(':');
+          if (indent_) {
+            writer_->write(' ');
+          }
+          after_key_ = true;
+        }
+      }
+
+      void open(char c) {
+        begin_value();
+        writer_->write(c);
+        ++depth_;
+        first_ = true;
+        key_ = false;
+      }
+
+      void close(char c) {
+        --depth_;
+        if (!first_ && indent_) {
+          write_indent();
+        }
+        writer_->write(c);
+        first_ = false;
+      }
+    };
+
+    class json_validator_t : public json_handler_t {
+    public:
+      virtual void literal(json_type_t) {}
+      virtual bool number(const char*, size_t, bool, bool) { return true; }
+      virtual void string(const char*, const char*) {}
+      virtual void escaped_string(const char*, const char*, const std::vector<char>&) {}
+      virtual void begin_object() {}
+      virtual void end_object() {}
+      virtual void begin_array() {}
+      virtual void end_array() {}
+      virtual void member() {}
+      virtual void element() {}
+    };
+
+    void impl_validate(lua_State* L) {
+      data_t data = check_data(L, 1);
+      validate_json(data.data(), data.size());
+      lua_pushboolean(L, true);
+    }
+  }
+
+  // Checks the syntax without creating any Lua values.
+  void validate_json(const char* data, size_t size) {
+    json_validator_t validator;
+    parse_json(validator, data, size);
+  }
+
+  // Writes the source with the indent, or without any whitespaces if the
+  // indent is 0. If the source is invalid, the tokens before the error have
+  // been written already.
+  void write_json_reformat(writer_t* writer, const char* data, size_t size, int indent) {
+    json_formatter_t formatter(writer, indent);
+    parse_json(formatter, data, size);
+  }
+
+  void initialize_json_format(lua_State* L) {
+    decltype(function<impl_validate>())::set_field(L, -1, "validate");
+  }
+}
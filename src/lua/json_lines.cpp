@@ -0,0 +1,429 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+#include "thread_reference.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <string.h>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    static const size_t default_batch_size = 1024 * 1024;
+
+    bool is_blank(const char* p, const char* pe) {
+      for (; p != pe; ++p) {
+        if (*p != ' ' && *p != '\t' && *p != '\r') {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    const char* find_newline(const char* p, const char* pe) {
+      if (const char* q = static_cast<const char*>(memchr(p, '\n', pe - p))) {
+        return q;
+      }
+      return pe;
+    }
+
+    // A chunk is a range of lines which a worker thread parses into a tape.
+    // The nodes of the records are appended to one tape, and the offsets of
+    // the nodes are relative to the beginning of each line.
+    struct json_lines_chunk_t {
+      struct record_t {
+        size_t offset;
+        size_t node;
+      };
+
+      size_t begin;
+      size_t end;
+      size_t lines;
+      std::vector<record_t> records;
+      std::vector<json_node_t> nodes;
+      std::vector<char> strings;
+      size_t cursor;
+      bool failed;
+      size_t error_line;
+      std::string error;
+
+      void parse(const char* data) {
+        lines = 0;
+        records.clear();
+        nodes.clear();
+        strings.clear();
+        cursor = 0;
+        failed = false;
+
+        try {
+          const char* p = data + begin;
+          const char* const pe = data + end;
+          while (p != pe) {
+            const char* q = find_newline(p, pe);
+            ++lines;
+            if (!is_blank(p, q)) {
+              record_t record = { static_cast<size_t>(p - data), nodes.size() };
+              append_json_tape(p, q - p, nodes, strings);
+              records.push_back(record);
+            }
+            p = q == pe ? q : q + 1;
+          }
+        } catch (const std::exception& e) {
+          failed = true;
+          error_line = lines;
+          error = e.what();
+        }
+      }
+    };
+
+    // The worker threads are started at the first batch and are kept until
+    // the iterator is collected. Worker i parses chunk i for each batch, and
+    // the calling thread parses chunk 0 and waits for the workers.
+    class json_lines_workers_t : private noncopyable {
+    public:
+      explicit json_lines_workers_t(std::vector<json_lines_chunk_t>& chunks)
+        : chunks_(chunks),
+          data_(),
+          generation_(),
+          running_(),
+          closed_() {}
+
+      ~json_lines_workers_t() {
+        close();
+      }
+
+      void parse(const char* data) {
+        if (threads_.empty()) {
+          start();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          data_ = data;
+          ++generation_;
+          running_ = threads_.size();
+        }
+        start_.notify_all();
+        chunks_[0].parse(data);
+        std::unique_lock<std::mutex> lock(mutex_);
+        finish_.wait(lock, [&]() { return running_ == 0; });
+      }
+
+    private:
+      std::vector<json_lines_chunk_t>& chunks_;
+      std::vector<std::thread> threads_;
+      std::mutex mutex_;
+      std::condition_variable start_;
+      std::condition_variable finish_;
+      const char* data_;
+      size_t generation_;
+      size_t running_;
+      bool closed_;
+
+      void start() {
+        try {
+          for (size_t i = 1; i < chunks_.size(); ++i) {
+            threads_.emplace_back([=]() { run(&chunks_[i]); });
+          }
+        } catch (...) {
+          close();
+          threads_.clear();
+          closed_ = false;
+          throw;
+        }
+      }
+
+      void close() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          closed_ = true;
+        }
+        start_.notify_all();
+        for (size_t i = 0; i < threads_.size(); ++i) {
+          threads_[i].join();
+        }
+      }
+
+      void run(json_lines_chunk_t* chunk) {
+        size_t generation = 0;
+        while (true) {
+          const char* data = nullptr;
+          {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&]() { return closed_ || generation_ != generation; });
+            if (closed_) {
+              return;
+            }
+            generation = generation_;
+            data = data_;
+          }
+          chunk->parse(data);
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --running_;
+          }
+          finish_.notify_one();
+        }
+      }
+    };
+
+    // The iterator keeps a reference to the source and gets its data at each
+    // step, so that a data_writer may be appended while iterating. The
+    // positions are offsets from the front of the data, so the iterator
+    // raises an error if the data_writer is consumed. A final line without
+    // a newline is parsed when the iterator reaches the end of the data, so
+    // a producer must append whole lines. The reference thread holds the
+    // source at index 1 and the null value at index 2. The scratch buffers
+    // of the parser are reused for all records.
+    //
+    // If threads is greater than 1, a batch of lines is split into chunks,
+    // and the chunks are parsed into tapes by the workers. The Lua values
+    // are created from the tapes on the calling thread in the record order.
+    // The tapes are built by the same machine as json.parse.
+    class json_lines_t : private noncopyable {
+    public:
+      json_lines_t(thread_reference&& ref, bool has_null, size_t threads, size_t batch_size)
+        : ref_(std::move(ref)),
+          has_null_(has_null),
+          batch_size_(batch_size),
+          position_(),
+          line_(),
+          record_(),
+          chunks_(threads > 1 ? threads : 0),
+          chunk_(),
+          consumed_(get_consumed()),
+          workers_(chunks_) {}
+
+      // Pushes the record number and the value of the next record, or
+      // returns false if no record is left.
+      bool next(lua_State* L) {
+        data_t data = to_data(ref_.get(), 1);
+        if (!data) {
+          throw BRIGID_LOGIC_ERROR("attempt to use a closed source");
+        }
+        if (get_consumed() != consumed_) {
+          throw BRIGID_LOGIC_ERROR("attempt to use a consumed source");
+        }
+        if (chunks_.empty()) {
+          return next_line(L, data);
+        } else {
+          return next_chunk(L, data);
+        }
+      }
+
+    private:
+      thread_reference ref_;
+      bool has_null_;
+      size_t batch_size_;
+      size_t position_;
+      size_t line_;
+      size_t record_;
+      json_parse_state_t state_;
+      std::vector<json_lines_chunk_t> chunks_;
+      size_t chunk_;
+      size_t consumed_;
+      json_lines_workers_t workers_;
+
+      size_t get_consumed() const {
+        if (const abstract_data_t* source = to_abstract_data_data_writer(ref_.get(), 1)) {
+          return source->consumed();
+        }
+        return 0;
+      }
+
+      // Pushes the record number, the null value and the metatable of the
+      // arrays. Returns the top of the stack after the record number.
+      int prepare(lua_State* L, int& null_index, int& array_index) {
+        push_integer(L, ++record_);
+        int top = lua_gettop(L);
+        null_index = 0;
+        if (has_null_) {
+          lua_pushvalue(ref_.get(), 2);
+          lua_xmove(ref_.get(), L, 1);
+          null_index = lua_gettop(L);
+        }
+        luaL_getmetatable(L, "brigid.json.array");
+        array_index = lua_gettop(L);
+        return top;
+      }
+
+      [[noreturn]] void error(size_t line, const char* what) const {
+        std::ostringstream out;
+        out << "line " << line << ": " << what;
+        throw BRIGID_LOGIC_ERROR(out.str());
+      }
+
+      bool next_line(lua_State* L, const data_t& data) {
+        const char* const pb = data.data();
+        const char* const pe = pb + data.size();
+        while (position_ < data.size()) {
+          const char* p = pb + position_;
+          const char* q = find_newline(p, pe);
+          position_ = q - pb + (q == pe ? 0 : 1);
+          ++line_;
+          if (is_blank(p, q)) {
+            continue;
+          }
+
+          int null_index = 0;
+          int array_index = 0;
+          int top = prepare(L, null_index, array_index);
+          try {
+            parse_json(L, p, q - p, null_index, array_index, state_);
+          } catch (const std::runtime_error& e) {
+            error(line_, e.what());
+          }
+          lua_replace(L, top + 1);
+          lua_settop(L, top + 1);
+          return true;
+        }
+        return false;
+      }
+
+      bool next_chunk(lua_State* L, const data_t& data) {
+        while (true) {
+          if (chunk_ < chunks_.size()) {
+            json_lines_chunk_t& chunk = chunks_[chunk_];
+            if (chunk.cursor < chunk.records.size()) {
+              const json_lines_chunk_t::record_t& record = chunk.records[chunk.cursor++];
+              int null_index = 0;
+              int array_index = 0;
+              int top = prepare(L, null_index, array_index);
+              push_json_tape(L, data.data() + record.offset, chunk.strings.data(), chunk.nodes, record.node, null_index, array_index, state_);
+              lua_replace(L, top + 1);
+              lua_settop(L, top + 1);
+              return true;
+            }
+            if (chunk.failed) {
+              error(line_ + chunk.error_line, chunk.error.c_str());
+            }
+            line_ += chunk.lines;
+            ++chunk_;
+            continue;
+          }
+
+          if (position_ >= data.size()) {
+            return false;
+          }
+          parse_batch(data);
+        }
+      }
+
+      // Splits the next batch into chunks at line boundaries, and parses
+      // them in parallel.
+      void parse_batch(const data_t& data) {
+        const char* const pb = data.data();
+        const char* const pe = pb + data.size();
+        size_t n = chunks_.size();
+
+        size_t end = data.size();
+        if (end - position_ > batch_size_ * n) {
+          end = find_newline(pb + position_ + batch_size_ * n, pe) - pb;
+          if (end < data.size()) {
+            ++end;
+          }
+        }
+
+        size_t begin = position_;
+        for (size_t i = 0; i < n; ++i) {
+          json_lines_chunk_t& chunk = chunks_[i];
+          chunk.begin = begin;
+          if (i + 1 < n) {
+            begin += (end - begin) / (n - i);
+            if (begin > chunk.begin && begin < end) {
+              begin = find_newline(pb + begin - 1, pb + end) - pb;
+              if (begin < end) {
+                ++begin;
+              }
+            }
+          } else {
+            begin = end;
+          }
+          chunk.end = begin;
+        }
+
+        workers_.parse(pb);
+
+        position_ = end;
+        chunk_ = 0;
+      }
+    };
+
+    json_lines_t* check_json_lines(lua_State* L, int arg) {
+      return check_udata<json_lines_t>(L, arg, "brigid.json.lines");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_json_lines(L, 1)->~json_lines_t();
+    }
+
+    int impl_next(lua_State* L) {
+      json_lines_t* self = check_json_lines(L, 1);
+      if (self->next(L)) {
+        return 2;
+      }
+      lua_pushnil(L);
+      return 1;
+    }
+
+    void impl_lines(lua_State* L) {
+      check_data(L, 1);
+      bool has_null = lua_gettop(L) >= 2;
+
+      size_t threads = 1;
+      size_t batch_size = default_batch_size;
+      if (!lua_isnoneornil(L, 3)) {
+        if (get_field(L, 3, "threads") != LUA_TNIL) {
+          threads = check_integer<size_t>(L, -1);
+          if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+          }
+        }
+        lua_pop(L, 1);
+
+        if (get_field(L, 3, "batch_size") != LUA_TNIL) {
+          batch_size = check_integer<size_t>(L, -1);
+          if (batch_size == 0) {
+            batch_size = 1;
+          }
+        }
+        lua_pop(L, 1);
+      }
+
+      thread_reference ref(L);
+      lua_pushvalue(L, 1);
+      lua_xmove(L, ref.get(), 1);
+      if (has_null) {
+        lua_pushvalue(L, 2);
+        lua_xmove(L, ref.get(), 1);
+      }
+
+      new_userdata<json_lines_t>(L, "brigid.json.lines", std::move(ref), has_null, threads, batch_size);
+    }
+  }
+
+  void initialize_json_lines(lua_State* L) {
+    new_metatable(L, "brigid.json.lines");
+    decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+    decltype(function<impl_next>())::set_field(L, -1, "__call");
+    lua_pop(L, 1);
+
+    decltype(function<impl_lines>())::set_field(L, -1, "lines");
+  }
+}
@@ -2,7 +2,7 @@
 #line 1 "json_parse.rl"
 // vim: syntax=ragel:
 
-// Copyright (c) 2021 <dev@brigid.jp>
+// Copyright (c) 2021,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -10,13 +10,19 @@
 #include "data.hpp"
 #include "error.hpp"
 #include "function.hpp"
+#include "json.hpp"
+#include "number.hpp"
+#include "scan.hpp"
+#include "view.hpp"
 
 #include <lua.hpp>
 
 #include <locale.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits>
+#include <memory>
 #include <sstream>
 #include <type_traits>
 #include <vector>
@@ -25,56 +31,274 @@ namespace brigid {
   namespace {
     using lua_unsigned_t = std::make_unsigned<lua_Integer>::type;
     static const size_t integer_digs = std::numeric_limits<lua_Integer>::digits10 + 1;
-    static const lua_unsigned_t integer_max_div10 = std::numeric_limits<lua_Integer>::max() / 10;
-    static const lua_unsigned_t integer_max_mod10 = std::numeric_limits<lua_Integer>::max() % 10;
+    static const uint64_t integer_max = std::numeric_limits<lua_Integer>::max();
+
+    // Returns the token from ps to pe. If the token is continued from the
+    // previous chunks, it is joined to the carried bytes.
+    inline const char* join_token(std::vector<char>& carry, const char* ps, const char* pe, size_t& size) {
+      if (carry.empty()) {
+        size = pe - ps;
+        return ps;
+      }
+      carry.insert(carry.end(), ps, pe);
+      size = carry.size();
+      return carry.data();
+    }
+
+    // Appends the token from ps to pe, and the carried bytes before it.
+    inline void append_token(std::vector<char>& buffer, std::vector<char>& carry, const char* ps, const char* pe) {
+      if (!carry.empty()) {
+        buffer.insert(buffer.end(), carry.begin(), carry.end());
+        carry.clear();
+      }
+      buffer.insert(buffer.end(), ps, pe);
+    }
 
     
-#line 33 "json_parse.cxx"
+#line 59 "json_parse.cxx"
 static const int json_parser_start = 1;
 
 
-#line 220 "json_parse.rl"
+#line 174 "json_parse.rl"
+  }
+
+  bool parse_json_number(const char* data, size_t size, bool terminated, bool& is_int, lua_Integer& integer, double& number, std::vector<char>& buffer) {
+    const char* const data_end = data + size;
+
+    if (is_int) {
+      const char* ptr = data;
+      lua_unsigned_t negative = 0;
+      if (*ptr == '-') {
+        negative = 1;
+        ++ptr;
+      }
+      size_t n = data_end - ptr;
+      if (n <= integer_digs) {
+        uint64_t u = parse_digits(ptr, n);
+        if (u <= integer_max + negative) {
+          lua_unsigned_t v = static_cast<lua_unsigned_t>(u);
+          integer = static_cast<lua_Integer>(negative ? 0 - v : v);
+          return true;
+        }
+      }
+      is_int = false;
+    }
+
+    // parse_double() gives up only if the number has too many significant
+    // digits or is too close to a rounding boundary.
+    if (parse_double(data, data_end, number)) {
+      return true;
+    }
+
+    // At the end-of-file, strtod() may not be able to find an unrecognized
+    // character, because the null termination is not guaranteed.
+    // Also, The decimal point is denpended to the locale. For example, the
+    // decimal point is ',' in the de_DE locale. In such a case, strtod() may
+    // read too small or too much.
+    char decimal_point = *localeconv()->decimal_point;
+    if (terminated && decimal_point == '.') {
+      char* end = nullptr;
+      number = strtod(data, &end);
+      return end == data_end;
+    }
+
+    buffer.resize(size + 1);
+    char* ptr = buffer.data();
+    memcpy(ptr, data, size);
+    ptr[size] = '\0';
+    if (decimal_point != '.') {
+      if (char* q = strchr(ptr, '.')) {
+        *q = decimal_point;
+      }
+    }
 
+    char* end = nullptr;
+    number = strtod(ptr, &end);
+    return end == ptr + size;
+  }
 
 #ifdef __GNUC__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wimplicit-fallthrough"
 #endif
 
-    int impl_parse(lua_State* L) {
-      data_t data = check_data(L, 1);
+  json_value_handler_t::json_value_handler_t(lua_State* L, int null_index, int array_index, json_parse_state_t& state)
+    : L_(L),
+      null_index_(null_index),
+      array_index_(array_index),
+      state_(state) {}
+
+  void json_value_handler_t::literal(json_type_t type) {
+    if (type == json_null) {
+      if (null_index_) {
+        lua_pushvalue(L_, null_index_);
+      } else {
+        lua_pushnil(L_);
+      }
+    } else {
+      lua_pushboolean(L_, type == json_true);
+    }
+  }
 
-      int cs = 0;
-      int top = lua_gettop(L);
+  bool json_value_handler_t::number(const char* data, size_t size, bool is_int, bool terminated) {
+    lua_Integer integer = 0;
+    double number = 0;
+    if (!parse_json_number(data, size, terminated, is_int, integer, number, state_.buffer)) {
+      return false;
+    }
+    if (is_int) {
+      lua_pushinteger(L_, integer);
+    } else {
+      lua_pushnumber(L_, number);
+    }
+    return true;
+  }
 
-      int null_index = top >= 2 ? 2 : 0;
-      luaL_getmetatable(L, "brigid.json.array");
-      int array_index = top + 1;
+  void json_value_handler_t::string(const char* ps, const char* pe) {
+    push_json_unescaped(L_, ps, pe - ps, state_);
+  }
 
-      
-#line 56 "json_parse.cxx"
-	{
-	cs = json_parser_start;
-	top = 0;
-	}
+  void json_value_handler_t::escaped_string(const char*, const char*, const std::vector<char>& buffer) {
+    lua_pushlstring(L_, buffer.data(), buffer.size());
+  }
+
+  void json_value_handler_t::begin_object() {
+    lua_checkstack(L_, 3);
+    lua_createtable(L_, 0, 8);
+  }
+
+  void json_value_handler_t::end_object() {}
+
+  void json_value_handler_t::begin_array() {
+    lua_checkstack(L_, 2);
+    lua_createtable(L_, 8, 0);
+    state_.array_stack.push_back(0);
+  }
 
-#line 238 "json_parse.rl"
+  void json_value_handler_t::end_array() {
+    lua_pushvalue(L_, array_index_);
+    lua_setmetatable(L_, -2);
+    state_.array_stack.pop_back();
+  }
+
+  // A key must be a string even if it is pushed as a view.
+  void json_value_handler_t::member() {
+    if (state_.view_threshold) {
+      if (view_t* view = to_udata<view_t>(L_, -2, "brigid.view")) {
+        lua_pushlstring(L_, view->data(), view->size());
+        lua_replace(L_, -3);
+      }
+    }
+    lua_rawset(L_, -3);
+  }
 
-      const char* const pb = data.data();
+  void json_value_handler_t::element() {
+    lua_rawseti(L_, -2, ++state_.array_stack.back());
+  }
+
+  namespace {
+    // Appends the nodes to the tape. The positions are relative to pb, and
+    // the decoded strings are appended to strings. It does not use Lua, so
+    // that it can be used from any thread.
+    class json_tape_builder_t final : public json_handler_t {
+    public:
+      json_tape_builder_t(const char* pb, std::vector<json_node_t>& nodes, std::vector<char>& strings)
+        : pb_(pb),
+          nodes_(nodes),
+          strings_(strings) {}
+
+      virtual void literal(json_type_t type) {
+        push_node(type, 0, 0);
+      }
+
+      virtual bool number(const char* data, size_t size, bool is_int, bool) {
+        nodes_[push_node(json_number, data - pb_, size)].is_int = is_int;
+        return true;
+      }
+
+      virtual void string(const char* ps, const char* pe) {
+        push_node(json_string, ps - pb_, pe - ps);
+      }
+
+      virtual void escaped_string(const char*, const char*, const std::vector<char>& buffer) {
+        nodes_[push_node(json_string, strings_.size(), buffer.size())].escaped = true;
+        strings_.insert(strings_.end(), buffer.begin(), buffer.end());
+      }
+
+      virtual void begin_object() {
+        stack_.push_back(push_node(json_object, 0, 0));
+      }
+
+      virtual void end_object() {
+        end_node();
+      }
+
+      virtual void begin_array() {
+        stack_.push_back(push_node(json_array, 0, 0));
+      }
+
+      virtual void end_array() {
+        end_node();
+      }
+
+      virtual void member() {
+        ++nodes_[stack_.back()].count;
+      }
+
+      virtual void element() {
+        ++nodes_[stack_.back()].count;
+      }
+
+    private:
+      const char* pb_;
+      std::vector<json_node_t>& nodes_;
+      std::vector<char>& strings_;
+      std::vector<size_t> stack_;
+
+      size_t push_node(json_type_t type, size_t offset, size_t size) {
+        size_t index = nodes_.size();
+        json_node_t node = { type, false, false, offset, size, index + 1, 0 };
+        nodes_.push_back(node);
+        return index;
+      }
+
+      void end_node() {
+        nodes_[stack_.back()].end = nodes_.size();
+        stack_.pop_back();
+      }
+    };
+
+    void start_json_value(json_parse_state_t& state) {
+      state.cs = json_parser_start;
+      state.top = 0;
+      state.token = false;
+      state.stack.clear();
+      state.array_stack.clear();
+      state.carry.clear();
+    }
+
+    // Runs the machine from data to pe, and returns where it stops. The
+    // machine stops before pe if it finds an unexpected byte. Otherwise, it
+    // is suspended at pe and can be resumed by the next chunk.
+    template <class T>
+    const char* parse_json_chunk(T& handler, const char* data, const char* pe, bool end_of_stream, json_parse_state_t& state) {
+      int cs = state.cs;
+      int top = state.top;
+
+      const char* const pb = data;
       const char* p = pb;
-      const char* const pe = p + data.size();
-      const char* const eof = pe;
-      std::vector<int> stack; stack.reserve(16);
+      const char* const eof = end_of_stream ? pe : nullptr;
+      std::vector<int>& stack = state.stack;
 
-      const char* ps = nullptr;
-      std::vector<char> buffer;
-      std::vector<int> array_stack;
-      bool is_int = false;    // number is integer
-      char decimal_point = 0; // *localeconv()->decimal_point
-      uint32_t u = 0;         // unicode escape sequence
+      const char* ps = state.token ? p : nullptr;
+      const char* pq = nullptr;   // opening quote of the string
+      std::vector<char>& buffer = state.buffer;
+      std::vector<char>& carry = state.carry;
+      bool is_int = state.is_int; // number is integer
+      uint32_t u = state.u;       // unicode escape sequence
 
       
-#line 78 "json_parse.cxx"
+#line 302 "json_parse.cxx"
 	{
 	if ( p == pe )
 		goto _test_eof;
@@ -212,14 +436,14 @@ st0:
 cs = 0;
 	goto _out;
 tr2:
-#line 194 "json_parse.rl"
-	{ ps = p + 1; }
+#line 148 "json_parse.rl"
+	{ ps = p + 1; pq = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q))-1;} } }
 	goto st2;
 st2:
 	if ( ++p == pe )
 		goto _test_eof2;
 case 2:
-#line 223 "json_parse.cxx"
+#line 447 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr12;
 		case 92: goto tr13;
@@ -235,133 +459,61 @@ case 3:
 	}
 	goto st3;
 tr6:
-#line 208 "json_parse.rl"
-	{ lua_checkstack(L, 2); lua_createtable(L, 8, 0); array_stack.push_back(0); { stack.push_back(0); {stack[top++] = 88;goto st64;}} }
+#line 162 "json_parse.rl"
+	{ if (stack.size() >= json_max_depth) { {cs = 0;goto _again;} } handler.begin_array(); { stack.push_back(0); {stack[top++] = 88;goto st64;}} }
 	goto st88;
 tr10:
-#line 207 "json_parse.rl"
-	{ lua_checkstack(L, 3); lua_createtable(L, 0, 8); { stack.push_back(0); {stack[top++] = 88;goto st36;}} }
+#line 161 "json_parse.rl"
+	{ if (stack.size() >= json_max_depth) { {cs = 0;goto _again;} } handler.begin_object(); { stack.push_back(0); {stack[top++] = 88;goto st36;}} }
 	goto st88;
 tr12:
-#line 195 "json_parse.rl"
-	{ lua_pushlstring(L, ps, 0); }
+#line 149 "json_parse.rl"
+	{ handler.string(ps, p); ps = nullptr; }
 	goto st88;
 tr13:
-#line 200 "json_parse.rl"
-	{ buffer.clear(); { stack.push_back(0); {stack[top++] = 88;goto st18;}} }
+#line 154 "json_parse.rl"
+	{ buffer.clear(); ps = nullptr; { stack.push_back(0); {stack[top++] = 88;goto st18;}} }
 	goto st88;
 tr14:
-#line 197 "json_parse.rl"
-	{ lua_pushlstring(L, ps, p - ps); }
+#line 151 "json_parse.rl"
+	{ if (carry.empty()) { handler.string(ps, p); } else { buffer.clear(); append_token(buffer, carry, ps, p); handler.escaped_string(pq, p + 1, buffer); } ps = nullptr; }
 	goto st88;
 tr15:
-#line 198 "json_parse.rl"
-	{ size_t n = p - ps; buffer.resize(n); memcpy(buffer.data(), ps, n); { stack.push_back(0); {stack[top++] = 88;goto st18;}} }
+#line 152 "json_parse.rl"
+	{ buffer.clear(); append_token(buffer, carry, ps, p); ps = nullptr; { stack.push_back(0); {stack[top++] = 88;goto st18;}} }
 	goto st88;
 tr24:
-#line 204 "json_parse.rl"
-	{ lua_pushboolean(L, false); }
+#line 158 "json_parse.rl"
+	{ handler.literal(json_false); }
 	goto st88;
 tr27:
-#line 205 "json_parse.rl"
-	{ if (null_index) { lua_pushvalue(L, null_index); } else { lua_pushnil(L); } }
+#line 159 "json_parse.rl"
+	{ handler.literal(json_null); }
 	goto st88;
 tr30:
-#line 206 "json_parse.rl"
-	{ lua_pushboolean(L, true); }
+#line 160 "json_parse.rl"
+	{ handler.literal(json_true); }
 	goto st88;
 tr180:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
 	goto st88;
 st88:
 	if ( ++p == pe )
 		goto _test_eof88;
 case 88:
-#line 365 "json_parse.cxx"
+#line 517 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto st88;
 		case 32: goto st88;
@@ -370,28 +522,28 @@ case 88:
 		goto st88;
 	goto st0;
 tr3:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st4;
 st4:
 	if ( ++p == pe )
 		goto _test_eof4;
 case 4:
-#line 381 "json_parse.cxx"
+#line 533 "json_parse.cxx"
 	if ( (*p) == 48 )
 		goto st89;
 	if ( 49 <= (*p) && (*p) <= 57 )
 		goto st92;
 	goto st0;
 tr4:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st89;
 st89:
 	if ( ++p == pe )
 		goto _test_eof89;
 case 89:
-#line 395 "json_parse.cxx"
+#line 547 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr180;
 		case 32: goto tr180;
@@ -403,14 +555,14 @@ case 89:
 		goto tr180;
 	goto st0;
 tr181:
-#line 39 "json_parse.rl"
+#line 65 "json_parse.rl"
 	{ is_int = false; }
 	goto st5;
 st5:
 	if ( ++p == pe )
 		goto _test_eof5;
 case 5:
-#line 414 "json_parse.cxx"
+#line 566 "json_parse.cxx"
 	if ( 48 <= (*p) && (*p) <= 57 )
 		goto st90;
 	goto st0;
@@ -431,14 +583,14 @@ case 90:
 		goto tr180;
 	goto st0;
 tr182:
-#line 40 "json_parse.rl"
+#line 66 "json_parse.rl"
 	{ is_int = false; }
 	goto st6;
 st6:
 	if ( ++p == pe )
 		goto _test_eof6;
 case 6:
-#line 442 "json_parse.cxx"
+#line 594 "json_parse.cxx"
 	switch( (*p) ) {
 		case 43: goto st7;
 		case 45: goto st7;
@@ -468,14 +620,14 @@ case 91:
 		goto tr180;
 	goto st0;
 tr5:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st92;
 st92:
 	if ( ++p == pe )
 		goto _test_eof92;
 case 92:
-#line 479 "json_parse.cxx"
+#line 631 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr180;
 		case 32: goto tr180;
@@ -576,53 +728,53 @@ case 18:
 	}
 	goto st0;
 tr31:
-#line 172 "json_parse.rl"
+#line 126 "json_parse.rl"
 	{ buffer.push_back('"'); }
 	goto st19;
 tr32:
-#line 174 "json_parse.rl"
+#line 128 "json_parse.rl"
 	{ buffer.push_back('/'); }
 	goto st19;
 tr33:
-#line 173 "json_parse.rl"
+#line 127 "json_parse.rl"
 	{ buffer.push_back('\\'); }
 	goto st19;
 tr34:
-#line 175 "json_parse.rl"
+#line 129 "json_parse.rl"
 	{ buffer.push_back('\b'); }
 	goto st19;
 tr35:
-#line 176 "json_parse.rl"
+#line 130 "json_parse.rl"
 	{ buffer.push_back('\f'); }
 	goto st19;
 tr36:
-#line 177 "json_parse.rl"
+#line 131 "json_parse.rl"
 	{ buffer.push_back('\n'); }
 	goto st19;
 tr37:
-#line 178 "json_parse.rl"
+#line 132 "json_parse.rl"
 	{ buffer.push_back('\r'); }
 	goto st19;
 tr38:
-#line 179 "json_parse.rl"
+#line 133 "json_parse.rl"
 	{ buffer.push_back('\t'); }
 	goto st19;
 st19:
 	if ( ++p == pe )
 		goto _test_eof19;
 case 19:
-#line 615 "json_parse.cxx"
+#line 767 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr41;
 		case 92: goto tr42;
 	}
 	goto tr40;
 tr40:
-#line 184 "json_parse.rl"
-	{ ps = p; }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
 	goto st20;
 tr60:
-#line 142 "json_parse.rl"
+#line 96 "json_parse.rl"
 	{
               if (u <= 0x007F) {
                 buffer.push_back(u);
@@ -638,13 +790,13 @@ tr60:
                 buffer.push_back(u3 | 0x80);
               }
             }
-#line 184 "json_parse.rl"
-	{ ps = p; }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
 	goto st20;
 tr84:
-#line 159 "json_parse.rl"
+#line 113 "json_parse.rl"
 	{
-              u = ((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00) | 0x010000;
+              u = (((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00)) + 0x10000;
               uint8_t u4 = u & 0x3F; u >>= 6;
               uint8_t u3 = u & 0x3F; u >>= 6;
               uint8_t u2 = u & 0x3F; u >>= 6;
@@ -653,41 +805,41 @@ tr84:
               buffer.push_back(u3 | 0x80);
               buffer.push_back(u4 | 0x80);
             }
-#line 184 "json_parse.rl"
-	{ ps = p; }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
 	goto st20;
 st20:
 	if ( ++p == pe )
 		goto _test_eof20;
 case 20:
-#line 664 "json_parse.cxx"
+#line 816 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr44;
 		case 92: goto tr45;
 	}
 	goto st20;
 tr41:
-#line 184 "json_parse.rl"
-	{ ps = p; }
-#line 185 "json_parse.rl"
-	{ lua_pushlstring(L, buffer.data(), buffer.size()); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
+#line 139 "json_parse.rl"
+	{ ps = nullptr; handler.escaped_string(pq, p + 1, buffer); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st93;
 tr42:
-#line 184 "json_parse.rl"
-	{ ps = p; }
-#line 190 "json_parse.rl"
-	{ {goto st18;} }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
+#line 144 "json_parse.rl"
+	{ ps = nullptr; {goto st18;} }
 	goto st93;
 tr44:
-#line 187 "json_parse.rl"
-	{ size_t m = buffer.size(); size_t n = p - ps; buffer.resize(m + n); char* ptr = buffer.data(); memcpy(ptr + m, ps, n); lua_pushlstring(L, ptr, m + n); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 141 "json_parse.rl"
+	{ append_token(buffer, carry, ps, p); ps = nullptr; handler.escaped_string(pq, p + 1, buffer); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st93;
 tr45:
-#line 188 "json_parse.rl"
-	{ size_t m = buffer.size(); size_t n = p - ps; buffer.resize(m + n); memcpy(buffer.data() + m, ps, n); {goto st18;} }
+#line 142 "json_parse.rl"
+	{ append_token(buffer, carry, ps, p); ps = nullptr; {goto st18;} }
 	goto st93;
 tr61:
-#line 142 "json_parse.rl"
+#line 96 "json_parse.rl"
 	{
               if (u <= 0x007F) {
                 buffer.push_back(u);
@@ -703,13 +855,13 @@ tr61:
                 buffer.push_back(u3 | 0x80);
               }
             }
-#line 184 "json_parse.rl"
-	{ ps = p; }
-#line 185 "json_parse.rl"
-	{ lua_pushlstring(L, buffer.data(), buffer.size()); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
+#line 139 "json_parse.rl"
+	{ ps = nullptr; handler.escaped_string(pq, p + 1, buffer); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st93;
 tr62:
-#line 142 "json_parse.rl"
+#line 96 "json_parse.rl"
 	{
               if (u <= 0x007F) {
                 buffer.push_back(u);
@@ -725,15 +877,15 @@ tr62:
                 buffer.push_back(u3 | 0x80);
               }
             }
-#line 184 "json_parse.rl"
-	{ ps = p; }
-#line 190 "json_parse.rl"
-	{ {goto st18;} }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
+#line 144 "json_parse.rl"
+	{ ps = nullptr; {goto st18;} }
 	goto st93;
 tr85:
-#line 159 "json_parse.rl"
+#line 113 "json_parse.rl"
 	{
-              u = ((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00) | 0x010000;
+              u = (((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00)) + 0x10000;
               uint8_t u4 = u & 0x3F; u >>= 6;
               uint8_t u3 = u & 0x3F; u >>= 6;
               uint8_t u2 = u & 0x3F; u >>= 6;
@@ -742,15 +894,15 @@ tr85:
               buffer.push_back(u3 | 0x80);
               buffer.push_back(u4 | 0x80);
             }
-#line 184 "json_parse.rl"
-	{ ps = p; }
-#line 185 "json_parse.rl"
-	{ lua_pushlstring(L, buffer.data(), buffer.size()); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
+#line 139 "json_parse.rl"
+	{ ps = nullptr; handler.escaped_string(pq, p + 1, buffer); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st93;
 tr86:
-#line 159 "json_parse.rl"
+#line 113 "json_parse.rl"
 	{
-              u = ((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00) | 0x010000;
+              u = (((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00)) + 0x10000;
               uint8_t u4 = u & 0x3F; u >>= 6;
               uint8_t u3 = u & 0x3F; u >>= 6;
               uint8_t u2 = u & 0x3F; u >>= 6;
@@ -759,26 +911,26 @@ tr86:
               buffer.push_back(u3 | 0x80);
               buffer.push_back(u4 | 0x80);
             }
-#line 184 "json_parse.rl"
-	{ ps = p; }
-#line 190 "json_parse.rl"
-	{ {goto st18;} }
+#line 138 "json_parse.rl"
+	{ ps = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q + 1))-1;} } }
+#line 144 "json_parse.rl"
+	{ ps = nullptr; {goto st18;} }
 	goto st93;
 st93:
 	if ( ++p == pe )
 		goto _test_eof93;
 case 93:
-#line 772 "json_parse.cxx"
+#line 924 "json_parse.cxx"
 	goto st0;
 tr39:
-#line 140 "json_parse.rl"
+#line 94 "json_parse.rl"
 	{ u = 0; }
 	goto st21;
 st21:
 	if ( ++p == pe )
 		goto _test_eof21;
 case 21:
-#line 782 "json_parse.cxx"
+#line 934 "json_parse.cxx"
 	switch( (*p) ) {
 		case 68: goto tr48;
 		case 100: goto tr50;
@@ -793,22 +945,22 @@ case 21:
 		goto tr47;
 	goto st0;
 tr46:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st22;
 tr47:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st22;
 tr49:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st22;
 st22:
 	if ( ++p == pe )
 		goto _test_eof22;
 case 22:
-#line 812 "json_parse.cxx"
+#line 964 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr51;
@@ -819,22 +971,22 @@ case 22:
 		goto tr52;
 	goto st0;
 tr51:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st23;
 tr52:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st23;
 tr53:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st23;
 st23:
 	if ( ++p == pe )
 		goto _test_eof23;
 case 23:
-#line 838 "json_parse.cxx"
+#line 990 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr54;
@@ -845,22 +997,22 @@ case 23:
 		goto tr55;
 	goto st0;
 tr54:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st24;
 tr55:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st24;
 tr56:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st24;
 st24:
 	if ( ++p == pe )
 		goto _test_eof24;
 case 24:
-#line 864 "json_parse.cxx"
+#line 1016 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr57;
@@ -871,46 +1023,46 @@ case 24:
 		goto tr58;
 	goto st0;
 tr57:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st25;
 tr58:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st25;
 tr59:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st25;
 st25:
 	if ( ++p == pe )
 		goto _test_eof25;
 case 25:
-#line 890 "json_parse.cxx"
+#line 1042 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr61;
 		case 92: goto tr62;
 	}
 	goto tr60;
 tr48:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st26;
 tr50:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st26;
 st26:
 	if ( ++p == pe )
 		goto _test_eof26;
 case 26:
-#line 908 "json_parse.cxx"
+#line 1060 "json_parse.cxx"
 	if ( (*p) < 56 ) {
 		if ( 48 <= (*p) && (*p) <= 55 )
 			goto tr51;
 	} else if ( (*p) > 57 ) {
-		if ( (*p) > 68 ) {
-			if ( 97 <= (*p) && (*p) <= 100 )
+		if ( (*p) > 66 ) {
+			if ( 97 <= (*p) && (*p) <= 98 )
 				goto tr65;
 		} else if ( (*p) >= 65 )
 			goto tr64;
@@ -918,22 +1070,22 @@ case 26:
 		goto tr63;
 	goto st0;
 tr63:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st27;
 tr64:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st27;
 tr65:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st27;
 st27:
 	if ( ++p == pe )
 		goto _test_eof27;
 case 27:
-#line 937 "json_parse.cxx"
+#line 1089 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr66;
@@ -944,22 +1096,22 @@ case 27:
 		goto tr67;
 	goto st0;
 tr66:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st28;
 tr67:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st28;
 tr68:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st28;
 st28:
 	if ( ++p == pe )
 		goto _test_eof28;
 case 28:
-#line 963 "json_parse.cxx"
+#line 1115 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr69;
@@ -970,22 +1122,22 @@ case 28:
 		goto tr70;
 	goto st0;
 tr69:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st29;
 tr70:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st29;
 tr71:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st29;
 st29:
 	if ( ++p == pe )
 		goto _test_eof29;
 case 29:
-#line 989 "json_parse.cxx"
+#line 1141 "json_parse.cxx"
 	if ( (*p) == 92 )
 		goto st30;
 	goto st0;
@@ -1006,18 +1158,18 @@ case 31:
 	}
 	goto st0;
 tr74:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st32;
 tr75:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st32;
 st32:
 	if ( ++p == pe )
 		goto _test_eof32;
 case 32:
-#line 1021 "json_parse.cxx"
+#line 1173 "json_parse.cxx"
 	if ( (*p) > 70 ) {
 		if ( 99 <= (*p) && (*p) <= 102 )
 			goto tr77;
@@ -1025,18 +1177,18 @@ case 32:
 		goto tr76;
 	goto st0;
 tr76:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st33;
 tr77:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st33;
 st33:
 	if ( ++p == pe )
 		goto _test_eof33;
 case 33:
-#line 1040 "json_parse.cxx"
+#line 1192 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr78;
@@ -1047,22 +1199,22 @@ case 33:
 		goto tr79;
 	goto st0;
 tr78:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st34;
 tr79:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st34;
 tr80:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st34;
 st34:
 	if ( ++p == pe )
 		goto _test_eof34;
 case 34:
-#line 1066 "json_parse.cxx"
+#line 1218 "json_parse.cxx"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto tr81;
@@ -1073,22 +1225,22 @@ case 34:
 		goto tr82;
 	goto st0;
 tr81:
-#line 134 "json_parse.rl"
+#line 88 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - '0'; }
 	goto st35;
 tr82:
-#line 135 "json_parse.rl"
+#line 89 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'A' + 10; }
 	goto st35;
 tr83:
-#line 136 "json_parse.rl"
+#line 90 "json_parse.rl"
 	{ u <<= 4; u |= (*p) - 'a' + 10; }
 	goto st35;
 st35:
 	if ( ++p == pe )
 		goto _test_eof35;
 case 35:
-#line 1092 "json_parse.cxx"
+#line 1244 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr85;
 		case 92: goto tr86;
@@ -1108,14 +1260,14 @@ case 36:
 		goto st36;
 	goto st0;
 tr88:
-#line 194 "json_parse.rl"
-	{ ps = p + 1; }
+#line 148 "json_parse.rl"
+	{ ps = p + 1; pq = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q))-1;} } }
 	goto st37;
 st37:
 	if ( ++p == pe )
 		goto _test_eof37;
 case 37:
-#line 1119 "json_parse.cxx"
+#line 1271 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr91;
 		case 92: goto tr92;
@@ -1131,26 +1283,26 @@ case 38:
 	}
 	goto st38;
 tr91:
-#line 195 "json_parse.rl"
-	{ lua_pushlstring(L, ps, 0); }
+#line 149 "json_parse.rl"
+	{ handler.string(ps, p); ps = nullptr; }
 	goto st39;
 tr92:
-#line 200 "json_parse.rl"
-	{ buffer.clear(); { stack.push_back(0); {stack[top++] = 39;goto st18;}} }
+#line 154 "json_parse.rl"
+	{ buffer.clear(); ps = nullptr; { stack.push_back(0); {stack[top++] = 39;goto st18;}} }
 	goto st39;
 tr93:
-#line 197 "json_parse.rl"
-	{ lua_pushlstring(L, ps, p - ps); }
+#line 151 "json_parse.rl"
+	{ if (carry.empty()) { handler.string(ps, p); } else { buffer.clear(); append_token(buffer, carry, ps, p); handler.escaped_string(pq, p + 1, buffer); } ps = nullptr; }
 	goto st39;
 tr94:
-#line 198 "json_parse.rl"
-	{ size_t n = p - ps; buffer.resize(n); memcpy(buffer.data(), ps, n); { stack.push_back(0); {stack[top++] = 39;goto st18;}} }
+#line 152 "json_parse.rl"
+	{ buffer.clear(); append_token(buffer, carry, ps, p); ps = nullptr; { stack.push_back(0); {stack[top++] = 39;goto st18;}} }
 	goto st39;
 st39:
 	if ( ++p == pe )
 		goto _test_eof39;
 case 39:
-#line 1154 "json_parse.cxx"
+#line 1306 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto st39;
 		case 32: goto st39;
@@ -1182,14 +1334,14 @@ case 40:
 		goto st40;
 	goto st0;
 tr97:
-#line 194 "json_parse.rl"
-	{ ps = p + 1; }
+#line 148 "json_parse.rl"
+	{ ps = p + 1; pq = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q))-1;} } }
 	goto st41;
 st41:
 	if ( ++p == pe )
 		goto _test_eof41;
 case 41:
-#line 1193 "json_parse.cxx"
+#line 1345 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr107;
 		case 92: goto tr108;
@@ -1205,46 +1357,46 @@ case 42:
 	}
 	goto st42;
 tr101:
-#line 208 "json_parse.rl"
-	{ lua_checkstack(L, 2); lua_createtable(L, 8, 0); array_stack.push_back(0); { stack.push_back(0); {stack[top++] = 43;goto st64;}} }
+#line 162 "json_parse.rl"
+	{ if (stack.size() >= json_max_depth) { {cs = 0;goto _again;} } handler.begin_array(); { stack.push_back(0); {stack[top++] = 43;goto st64;}} }
 	goto st43;
 tr105:
-#line 207 "json_parse.rl"
-	{ lua_checkstack(L, 3); lua_createtable(L, 0, 8); { stack.push_back(0); {stack[top++] = 43;goto st36;}} }
+#line 161 "json_parse.rl"
+	{ if (stack.size() >= json_max_depth) { {cs = 0;goto _again;} } handler.begin_object(); { stack.push_back(0); {stack[top++] = 43;goto st36;}} }
 	goto st43;
 tr107:
-#line 195 "json_parse.rl"
-	{ lua_pushlstring(L, ps, 0); }
+#line 149 "json_parse.rl"
+	{ handler.string(ps, p); ps = nullptr; }
 	goto st43;
 tr108:
-#line 200 "json_parse.rl"
-	{ buffer.clear(); { stack.push_back(0); {stack[top++] = 43;goto st18;}} }
+#line 154 "json_parse.rl"
+	{ buffer.clear(); ps = nullptr; { stack.push_back(0); {stack[top++] = 43;goto st18;}} }
 	goto st43;
 tr109:
-#line 197 "json_parse.rl"
-	{ lua_pushlstring(L, ps, p - ps); }
+#line 151 "json_parse.rl"
+	{ if (carry.empty()) { handler.string(ps, p); } else { buffer.clear(); append_token(buffer, carry, ps, p); handler.escaped_string(pq, p + 1, buffer); } ps = nullptr; }
 	goto st43;
 tr110:
-#line 198 "json_parse.rl"
-	{ size_t n = p - ps; buffer.resize(n); memcpy(buffer.data(), ps, n); { stack.push_back(0); {stack[top++] = 43;goto st18;}} }
+#line 152 "json_parse.rl"
+	{ buffer.clear(); append_token(buffer, carry, ps, p); ps = nullptr; { stack.push_back(0); {stack[top++] = 43;goto st18;}} }
 	goto st43;
 tr130:
-#line 204 "json_parse.rl"
-	{ lua_pushboolean(L, false); }
+#line 158 "json_parse.rl"
+	{ handler.literal(json_false); }
 	goto st43;
 tr133:
-#line 205 "json_parse.rl"
-	{ if (null_index) { lua_pushvalue(L, null_index); } else { lua_pushnil(L); } }
+#line 159 "json_parse.rl"
+	{ handler.literal(json_null); }
 	goto st43;
 tr136:
-#line 206 "json_parse.rl"
-	{ lua_pushboolean(L, true); }
+#line 160 "json_parse.rl"
+	{ handler.literal(json_true); }
 	goto st43;
 st43:
 	if ( ++p == pe )
 		goto _test_eof43;
 case 43:
-#line 1248 "json_parse.cxx"
+#line 1400 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr111;
 		case 32: goto tr111;
@@ -1255,103 +1407,31 @@ case 43:
 		goto tr111;
 	goto st0;
 tr111:
-#line 213 "json_parse.rl"
-	{ lua_rawset(L, -3); }
+#line 167 "json_parse.rl"
+	{ handler.member(); }
 	goto st44;
 tr118:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
-#line 213 "json_parse.rl"
-	{ lua_rawset(L, -3); }
+#line 167 "json_parse.rl"
+	{ handler.member(); }
 	goto st44;
 st44:
 	if ( ++p == pe )
 		goto _test_eof44;
 case 44:
-#line 1355 "json_parse.cxx"
+#line 1435 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto st44;
 		case 32: goto st44;
@@ -1362,103 +1442,31 @@ case 44:
 		goto st44;
 	goto st0;
 tr112:
-#line 213 "json_parse.rl"
-	{ lua_rawset(L, -3); }
+#line 167 "json_parse.rl"
+	{ handler.member(); }
 	goto st45;
 tr119:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
-#line 213 "json_parse.rl"
-	{ lua_rawset(L, -3); }
+#line 167 "json_parse.rl"
+	{ handler.member(); }
 	goto st45;
 st45:
 	if ( ++p == pe )
 		goto _test_eof45;
 case 45:
-#line 1462 "json_parse.cxx"
+#line 1470 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto st45;
 		case 32: goto st45;
@@ -1468,135 +1476,63 @@ case 45:
 		goto st45;
 	goto st0;
 tr89:
-#line 214 "json_parse.rl"
-	{ {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 168 "json_parse.rl"
+	{ handler.end_object(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st94;
 tr113:
-#line 213 "json_parse.rl"
-	{ lua_rawset(L, -3); }
-#line 214 "json_parse.rl"
-	{ {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 167 "json_parse.rl"
+	{ handler.member(); }
+#line 168 "json_parse.rl"
+	{ handler.end_object(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st94;
 tr122:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
-#line 213 "json_parse.rl"
-	{ lua_rawset(L, -3); }
-#line 214 "json_parse.rl"
-	{ {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 167 "json_parse.rl"
+	{ handler.member(); }
+#line 168 "json_parse.rl"
+	{ handler.end_object(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st94;
 st94:
 	if ( ++p == pe )
 		goto _test_eof94;
 case 94:
-#line 1576 "json_parse.cxx"
+#line 1512 "json_parse.cxx"
 	goto st0;
 tr98:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st46;
 st46:
 	if ( ++p == pe )
 		goto _test_eof46;
 case 46:
-#line 1586 "json_parse.cxx"
+#line 1522 "json_parse.cxx"
 	if ( (*p) == 48 )
 		goto st47;
 	if ( 49 <= (*p) && (*p) <= 57 )
 		goto st53;
 	goto st0;
 tr99:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st47;
 st47:
 	if ( ++p == pe )
 		goto _test_eof47;
 case 47:
-#line 1600 "json_parse.cxx"
+#line 1536 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr118;
 		case 32: goto tr118;
@@ -1610,14 +1546,14 @@ case 47:
 		goto tr118;
 	goto st0;
 tr120:
-#line 39 "json_parse.rl"
+#line 65 "json_parse.rl"
 	{ is_int = false; }
 	goto st48;
 st48:
 	if ( ++p == pe )
 		goto _test_eof48;
 case 48:
-#line 1621 "json_parse.cxx"
+#line 1557 "json_parse.cxx"
 	if ( 48 <= (*p) && (*p) <= 57 )
 		goto st49;
 	goto st0;
@@ -1640,14 +1576,14 @@ case 49:
 		goto tr118;
 	goto st0;
 tr121:
-#line 40 "json_parse.rl"
+#line 66 "json_parse.rl"
 	{ is_int = false; }
 	goto st50;
 st50:
 	if ( ++p == pe )
 		goto _test_eof50;
 case 50:
-#line 1651 "json_parse.cxx"
+#line 1587 "json_parse.cxx"
 	switch( (*p) ) {
 		case 43: goto st51;
 		case 45: goto st51;
@@ -1679,14 +1615,14 @@ case 52:
 		goto tr118;
 	goto st0;
 tr100:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st53;
 st53:
 	if ( ++p == pe )
 		goto _test_eof53;
 case 53:
-#line 1690 "json_parse.cxx"
+#line 1626 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr118;
 		case 32: goto tr118;
@@ -1796,14 +1732,14 @@ case 64:
 		goto st64;
 	goto st0;
 tr138:
-#line 194 "json_parse.rl"
-	{ ps = p + 1; }
+#line 148 "json_parse.rl"
+	{ ps = p + 1; pq = p; if (const char* q = scan_json_string_last(ps, pe)) { {p = (( q))-1;} } }
 	goto st65;
 st65:
 	if ( ++p == pe )
 		goto _test_eof65;
 case 65:
-#line 1807 "json_parse.cxx"
+#line 1743 "json_parse.cxx"
 	switch( (*p) ) {
 		case 34: goto tr149;
 		case 92: goto tr150;
@@ -1819,46 +1755,46 @@ case 66:
 	}
 	goto st66;
 tr142:
-#line 208 "json_parse.rl"
-	{ lua_checkstack(L, 2); lua_createtable(L, 8, 0); array_stack.push_back(0); { stack.push_back(0); {stack[top++] = 67;goto st64;}} }
+#line 162 "json_parse.rl"
+	{ if (stack.size() >= json_max_depth) { {cs = 0;goto _again;} } handler.begin_array(); { stack.push_back(0); {stack[top++] = 67;goto st64;}} }
 	goto st67;
 tr147:
-#line 207 "json_parse.rl"
-	{ lua_checkstack(L, 3); lua_createtable(L, 0, 8); { stack.push_back(0); {stack[top++] = 67;goto st36;}} }
+#line 161 "json_parse.rl"
+	{ if (stack.size() >= json_max_depth) { {cs = 0;goto _again;} } handler.begin_object(); { stack.push_back(0); {stack[top++] = 67;goto st36;}} }
 	goto st67;
 tr149:
-#line 195 "json_parse.rl"
-	{ lua_pushlstring(L, ps, 0); }
+#line 149 "json_parse.rl"
+	{ handler.string(ps, p); ps = nullptr; }
 	goto st67;
 tr150:
-#line 200 "json_parse.rl"
-	{ buffer.clear(); { stack.push_back(0); {stack[top++] = 67;goto st18;}} }
+#line 154 "json_parse.rl"
+	{ buffer.clear(); ps = nullptr; { stack.push_back(0); {stack[top++] = 67;goto st18;}} }
 	goto st67;
 tr151:
-#line 197 "json_parse.rl"
-	{ lua_pushlstring(L, ps, p - ps); }
+#line 151 "json_parse.rl"
+	{ if (carry.empty()) { handler.string(ps, p); } else { buffer.clear(); append_token(buffer, carry, ps, p); handler.escaped_string(pq, p + 1, buffer); } ps = nullptr; }
 	goto st67;
 tr152:
-#line 198 "json_parse.rl"
-	{ size_t n = p - ps; buffer.resize(n); memcpy(buffer.data(), ps, n); { stack.push_back(0); {stack[top++] = 67;goto st18;}} }
+#line 152 "json_parse.rl"
+	{ buffer.clear(); append_token(buffer, carry, ps, p); ps = nullptr; { stack.push_back(0); {stack[top++] = 67;goto st18;}} }
 	goto st67;
 tr172:
-#line 204 "json_parse.rl"
-	{ lua_pushboolean(L, false); }
+#line 158 "json_parse.rl"
+	{ handler.literal(json_false); }
 	goto st67;
 tr175:
-#line 205 "json_parse.rl"
-	{ if (null_index) { lua_pushvalue(L, null_index); } else { lua_pushnil(L); } }
+#line 159 "json_parse.rl"
+	{ handler.literal(json_null); }
 	goto st67;
 tr178:
-#line 206 "json_parse.rl"
-	{ lua_pushboolean(L, true); }
+#line 160 "json_parse.rl"
+	{ handler.literal(json_true); }
 	goto st67;
 st67:
 	if ( ++p == pe )
 		goto _test_eof67;
 case 67:
-#line 1862 "json_parse.cxx"
+#line 1798 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr153;
 		case 32: goto tr153;
@@ -1869,103 +1805,31 @@ case 67:
 		goto tr153;
 	goto st0;
 tr153:
-#line 215 "json_parse.rl"
-	{ lua_rawseti(L, -2, ++array_stack.back()); }
+#line 169 "json_parse.rl"
+	{ handler.element(); }
 	goto st68;
 tr160:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
-#line 215 "json_parse.rl"
-	{ lua_rawseti(L, -2, ++array_stack.back()); }
+#line 169 "json_parse.rl"
+	{ handler.element(); }
 	goto st68;
 st68:
 	if ( ++p == pe )
 		goto _test_eof68;
 case 68:
-#line 1969 "json_parse.cxx"
+#line 1833 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto st68;
 		case 32: goto st68;
@@ -1976,103 +1840,31 @@ case 68:
 		goto st68;
 	goto st0;
 tr154:
-#line 215 "json_parse.rl"
-	{ lua_rawseti(L, -2, ++array_stack.back()); }
+#line 169 "json_parse.rl"
+	{ handler.element(); }
 	goto st69;
 tr161:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
-#line 215 "json_parse.rl"
-	{ lua_rawseti(L, -2, ++array_stack.back()); }
+#line 169 "json_parse.rl"
+	{ handler.element(); }
 	goto st69;
 st69:
 	if ( ++p == pe )
 		goto _test_eof69;
 case 69:
-#line 2076 "json_parse.cxx"
+#line 1868 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto st69;
 		case 32: goto st69;
@@ -2092,28 +1884,28 @@ case 69:
 		goto st69;
 	goto st0;
 tr139:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st70;
 st70:
 	if ( ++p == pe )
 		goto _test_eof70;
 case 70:
-#line 2103 "json_parse.cxx"
+#line 1895 "json_parse.cxx"
 	if ( (*p) == 48 )
 		goto st71;
 	if ( 49 <= (*p) && (*p) <= 57 )
 		goto st77;
 	goto st0;
 tr140:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st71;
 st71:
 	if ( ++p == pe )
 		goto _test_eof71;
 case 71:
-#line 2117 "json_parse.cxx"
+#line 1909 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr160;
 		case 32: goto tr160;
@@ -2127,14 +1919,14 @@ case 71:
 		goto tr160;
 	goto st0;
 tr162:
-#line 39 "json_parse.rl"
+#line 65 "json_parse.rl"
 	{ is_int = false; }
 	goto st72;
 st72:
 	if ( ++p == pe )
 		goto _test_eof72;
 case 72:
-#line 2138 "json_parse.cxx"
+#line 1930 "json_parse.cxx"
 	if ( 48 <= (*p) && (*p) <= 57 )
 		goto st73;
 	goto st0;
@@ -2157,14 +1949,14 @@ case 73:
 		goto tr160;
 	goto st0;
 tr163:
-#line 40 "json_parse.rl"
+#line 66 "json_parse.rl"
 	{ is_int = false; }
 	goto st74;
 st74:
 	if ( ++p == pe )
 		goto _test_eof74;
 case 74:
-#line 2168 "json_parse.cxx"
+#line 1960 "json_parse.cxx"
 	switch( (*p) ) {
 		case 43: goto st75;
 		case 45: goto st75;
@@ -2196,121 +1988,49 @@ case 76:
 		goto tr160;
 	goto st0;
 tr143:
-#line 216 "json_parse.rl"
-	{ lua_pushvalue(L, array_index); lua_setmetatable(L, -2); array_stack.pop_back(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 170 "json_parse.rl"
+	{ handler.end_array(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st95;
 tr155:
-#line 215 "json_parse.rl"
-	{ lua_rawseti(L, -2, ++array_stack.back()); }
-#line 216 "json_parse.rl"
-	{ lua_pushvalue(L, array_index); lua_setmetatable(L, -2); array_stack.pop_back(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 169 "json_parse.rl"
+	{ handler.element(); }
+#line 170 "json_parse.rl"
+	{ handler.end_array(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st95;
 tr164:
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
-#line 215 "json_parse.rl"
-	{ lua_rawseti(L, -2, ++array_stack.back()); }
-#line 216 "json_parse.rl"
-	{ lua_pushvalue(L, array_index); lua_setmetatable(L, -2); array_stack.pop_back(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
+#line 169 "json_parse.rl"
+	{ handler.element(); }
+#line 170 "json_parse.rl"
+	{ handler.end_array(); {cs = stack[--top];{ stack.pop_back(); }goto _again;} }
 	goto st95;
 st95:
 	if ( ++p == pe )
 		goto _test_eof95;
 case 95:
-#line 2304 "json_parse.cxx"
+#line 2024 "json_parse.cxx"
 	goto st0;
 tr141:
-#line 42 "json_parse.rl"
+#line 68 "json_parse.rl"
 	{ ps = p; is_int = true; }
 	goto st77;
 st77:
 	if ( ++p == pe )
 		goto _test_eof77;
 case 77:
-#line 2314 "json_parse.cxx"
+#line 2034 "json_parse.cxx"
 	switch( (*p) ) {
 		case 13: goto tr160;
 		case 32: goto tr160;
@@ -2501,113 +2221,174 @@ case 87:
 	case 90: 
 	case 91: 
 	case 92: 
-#line 43 "json_parse.rl"
+#line 69 "json_parse.rl"
 	{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = p - ptr;
-              if (n < integer_digs) {
-                for (; ptr != p; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != p - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (p != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == p) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = p - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, p, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && p != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (p - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           }
 	break;
-#line 2591 "json_parse.cxx"
+#line 2239 "json_parse.cxx"
 	}
 	}
 
 	_out: {}
 	}
 
-#line 253 "json_parse.rl"
+#line 413 "json_parse.rl"
+
+      if (ps && p == pe) {
+        carry.insert(carry.end(), ps, pe);
+      }
+      state.cs = cs;
+      state.top = top;
+      state.token = ps != nullptr;
+      state.is_int = is_int;
+      state.u = u;
+      return p;
+    }
+
+    template <class T>
+    void parse_json_impl(T& handler, const char* data, size_t size, json_parse_state_t& state) {
+      start_json_value(state);
+      state.position = 0;
+      const char* p = parse_json_chunk(handler, data, data + size, true, state);
 
-      if (cs >= 88 && stack.empty()) {
-        return 1;
+      if (state.cs >= 88 && state.stack.empty()) {
+        return;
       }
 
       std::ostringstream out;
-      out << "cannot parse json at position " << (p - pb + 1);
+      out << "cannot parse json at position " << (p - data + 1);
       throw BRIGID_RUNTIME_ERROR(out.str());
     }
+  }
+
+  void parse_json(lua_State* L, const char* data, size_t size, int null_index, int array_index, json_parse_state_t& state) {
+    json_value_handler_t handler(L, null_index, array_index, state);
+    parse_json_impl(handler, data, size, state);
+  }
+
+  void parse_json(json_handler_t& handler, const char* data, size_t size) {
+    json_parse_state_t state;
+    parse_json_impl(handler, data, size, state);
+  }
+
+  // Parses the top-level values of a stream, which are separated by
+  // whitespace if needed. Returns true if a value is completed and pushed,
+  // and advances data past it. Otherwise, the chunk is consumed and the
+  // partially built values are kept on the stack of L.
+  bool parse_json_stream(lua_State* L, const char*& data, const char* pe, bool end_of_stream, int null_index, int array_index, json_parse_state_t& state) {
+    if (state.cs == 0) {
+      start_json_value(state);
+      state.base = lua_gettop(L);
+    }
+    json_value_handler_t handler(L, null_index, array_index, state);
+    const char* p = parse_json_chunk(handler, data, pe, end_of_stream, state);
+    state.position += p - data;
+    data = p;
+
+    // The machine stops at the byte next to a completed value.
+    if (state.stack.empty() && lua_gettop(L) > state.base) {
+      state.cs = 0;
+      return true;
+    }
+    if (state.cs == 0 || (end_of_stream && state.cs != json_parser_start)) {
+      std::ostringstream out;
+      out << "cannot parse json at position " << (state.position + 1);
+      throw BRIGID_RUNTIME_ERROR(out.str());
+    }
+    return false;
+  }
+
+  void parse_json_tape(const char* data, size_t size, std::vector<json_node_t>& nodes, std::vector<char>& strings) {
+    nodes.clear();
+    strings.clear();
+    append_json_tape(data, size, nodes, strings);
+  }
+
+  void append_json_tape(const char* data, size_t size, std::vector<json_node_t>& nodes, std::vector<char>& strings) {
+    json_tape_builder_t builder(data, nodes, strings);
+    json_parse_state_t state;
+    parse_json_impl(builder, data, size, state);
+  }
 
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
+
+  void push_json_unescaped(lua_State* L, const char* data, size_t size, json_parse_state_t& state) {
+    if (state.view_threshold && size >= state.view_threshold) {
+      new_view(L, data, size, state.view_ref);
+    } else {
+      lua_pushlstring(L, data, size);
+    }
+  }
+
+  namespace {
+    int impl_parse(lua_State* L) {
+      data_t data = check_data(L, 1);
+
+      int top = lua_gettop(L);
+      int null_index = top >= 2 ? 2 : 0;
+      luaL_getmetatable(L, "brigid.json.array");
+      int array_index = top + 1;
+
+      json_projection_t projection;
+      if (top >= 3) {
+        if (get_field(L, 3, "keep") != LUA_TNIL) {
+          luaL_checktype(L, -1, LUA_TTABLE);
+          for (int i = 1; ; ++i) {
+            lua_rawgeti(L, -1, i);
+            size_t size = 0;
+            const char* path = lua_tolstring(L, -1, &size);
+            lua_pop(L, 1);
+            if (!path) {
+              break;
+            }
+            projection.add(path, size);
+          }
+        }
+        lua_pop(L, 1);
+      }
+
+      // The views refer to the bytes of a string source, which are not
+      // moved while the string is alive.
+      json_parse_state_t state;
+      if (top >= 3) {
+        if (get_field(L, 3, "view_threshold") != LUA_TNIL) {
+          state.view_threshold = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+        if (state.view_threshold) {
+          if (lua_type(L, 1) != LUA_TSTRING) {
+            throw BRIGID_LOGIC_ERROR("view_threshold needs a string source");
+          }
+          state.view_ref = std::make_shared<view_reference_t>(L);
+          lua_pushvalue(L, 1);
+          lua_xmove(L, state.view_ref->get(), 1);
+        }
+      }
+
+      if (projection.empty()) {
+        parse_json(L, data.data(), data.size(), null_index, array_index, state);
+      } else {
+        // Parse into a tape and create the Lua values only for the kept
+        // members.
+        std::vector<json_node_t> nodes;
+        std::vector<char> strings;
+        parse_json_tape(data.data(), data.size(), nodes, strings);
+        push_json_projection(L, data.data(), strings.data(), nodes, 0, projection, 0, null_index, array_index, state);
+      }
+      return 1;
+    }
   }
 
   void initialize_json_parse(lua_State* L) {
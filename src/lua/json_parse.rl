@@ -1,6 +1,6 @@
 // vim: syntax=ragel:
 
-// Copyright (c) 2021 <dev@brigid.jp>
+// Copyright (c) 2021,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -8,13 +8,19 @@
 #include "data.hpp"
 #include "error.hpp"
 #include "function.hpp"
+#include "json.hpp"
+#include "number.hpp"
+#include "scan.hpp"
+#include "view.hpp"
 
 #include <lua.hpp>
 
 #include <locale.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits>
+#include <memory>
 #include <sstream>
 #include <type_traits>
 #include <vector>
@@ -23,8 +29,28 @@ namespace brigid {
   namespace {
     using lua_unsigned_t = std::make_unsigned<lua_Integer>::type;
     static const size_t integer_digs = std::numeric_limits<lua_Integer>::digits10 + 1;
-    static const lua_unsigned_t integer_max_div10 = std::numeric_limits<lua_Integer>::max() / 10;
-    static const lua_unsigned_t integer_max_mod10 = std::numeric_limits<lua_Integer>::max() % 10;
+    static const uint64_t integer_max = std::numeric_limits<lua_Integer>::max();
+
+    // Returns the token from ps to pe. If the token is continued from the
+    // previous chunks, it is joined to the carried bytes.
+    inline const char* join_token(std::vector<char>& carry, const char* ps, const char* pe, size_t& size) {
+      if (carry.empty()) {
+        size = pe - ps;
+        return ps;
+      }
+      carry.insert(carry.end(), ps, pe);
+      size = carry.size();
+      return carry.data();
+    }
+
+    // Appends the token from ps to pe, and the carried bytes before it.
+    inline void append_token(std::vector<char>& buffer, std::vector<char>& carry, const char* ps, const char* pe) {
+      if (!carry.empty()) {
+        buffer.insert(buffer.end(), carry.begin(), carry.end());
+        carry.clear();
+      }
+      buffer.insert(buffer.end(), ps, pe);
+    }
 
     %%{
       machine json_parser;
@@ -41,88 +67,16 @@ namespace brigid {
           )
         ) >{ ps = fpc; is_int = true; }
           %{
-            lua_unsigned_t v = 0;
-            lua_unsigned_t negative = 0;
-
-            if (is_int) {
-              const char* ptr = ps;
-              if (*ptr == '-') {
-                negative = 1;
-                ++ptr;
-              }
-              size_t n = fpc - ptr;
-              if (n < integer_digs) {
-                for (; ptr != fpc; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-              } else if (n == integer_digs) {
-                for (; ptr != fpc - 1; ++ptr) {
-                  v *= 10;
-                  v += *ptr - '0';
-                }
-                lua_unsigned_t u = *ptr - '0';
-                if (v > integer_max_div10 || (v == integer_max_div10 && u > integer_max_mod10 + negative)) {
-                  is_int = false;
-                } else {
-                  v *= 10;
-                  v += u;
-                }
-              } else {
-                is_int = false;
-              }
-            }
-
-            if (is_int) {
-              if (negative) {
-                lua_pushinteger(L, 0 - v);
-              } else {
-                lua_pushinteger(L, v);
-              }
-            } else {
-              // At the end-of-file, strtod() may not be able to find an
-              // unrecognized character, because the null termination is not
-              // guaranteed.
-              // Also, The decimal point is denpended to the locale. For
-              // example, the decimal point is ',' in the de_DE locale. In such
-              // a case, strtod() may read too small or too much.
-              do {
-                if (fpc != eof && !decimal_point) {
-                  char* end = nullptr;
-                  double v = strtod(ps, &end);
-                  if (end == fpc) {
-                    lua_pushnumber(L, v);
-                    break;
-                  }
-                }
-
-                size_t n = fpc - ps;
-                buffer.resize(n + 1);
-                char* ptr = buffer.data();
-                memcpy(ptr, ps, n);
-                ptr[n] = '\0';
-
-                if (!decimal_point) {
-                  decimal_point = *localeconv()->decimal_point;
-                }
-                if (decimal_point != '.') {
-                  if (char* q = strchr(ptr, '.')) {
-                    *q = decimal_point;
-                  }
-                }
-
-                char* end = nullptr;
-                double v = strtod(ptr, &end);
-                if (end == ptr + n) {
-                  lua_pushnumber(L, v);
-                  break;
-                }
-
-                std::ostringstream out;
-                out << "cannot strtod at position " << (ps - pb + 1);
-                throw BRIGID_RUNTIME_ERROR(out.str());
-              } while (false);
+            size_t size = 0;
+            const char* token = join_token(carry, ps, fpc, size);
+            // A joined token is not followed by the source.
+            if (!handler.number(token, size, is_int, token == ps && fpc != eof)) {
+              std::ostringstream out;
+              out << "cannot strtod at position " << (state.position + (fpc - pb) - size + 1);
+              throw BRIGID_RUNTIME_ERROR(out.str());
             }
+            carry.clear();
+            ps = nullptr;
           };
 
       # Accept not valid UTF-8 characters
@@ -155,9 +109,9 @@ namespace brigid {
               }
             }
           |
-          ((hex_quad & (/D[89A-D]/i xdigit{2})) "\\u" (hex_quad & /D[C-F]/i xdigit{2}))
+          ((hex_quad & (/D[89AB]/i xdigit{2})) "\\u" (hex_quad & /D[C-F]/i xdigit{2}))
             %{
-              u = ((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00) | 0x010000;
+              u = (((u >> 16) - 0xD800) << 10 | ((u & 0xFFFF) - 0xDC00)) + 0x10000;
               uint8_t u4 = u & 0x3F; u >>= 6;
               uint8_t u3 = u & 0x3F; u >>= 6;
               uint8_t u2 = u & 0x3F; u >>= 6;
@@ -181,88 +135,427 @@ namespace brigid {
         );
 
       string_impl :=
-        escape_sequence %{ ps = fpc; }
-        ( "\"" @{ lua_pushlstring(L, buffer.data(), buffer.size()); fret; }
+        escape_sequence %{ ps = fpc; if (const char* q = scan_json_string_last(ps, pe)) { fexec q + 1; } }
+        ( "\"" @{ ps = nullptr; handler.escaped_string(pq, fpc + 1, buffer); fret; }
         | unescaped+
-          ( "\"" @{ size_t m = buffer.size(); size_t n = fpc - ps; buffer.resize(m + n); char* ptr = buffer.data(); memcpy(ptr + m, ps, n); lua_pushlstring(L, ptr, m + n); fret; }
-          | "\\" @{ size_t m = buffer.size(); size_t n = fpc - ps; buffer.resize(m + n); memcpy(buffer.data() + m, ps, n); fgoto string_impl; }
+          ( "\"" @{ append_token(buffer, carry, ps, fpc); ps = nullptr; handler.escaped_string(pq, fpc + 1, buffer); fret; }
+          | "\\" @{ append_token(buffer, carry, ps, fpc); ps = nullptr; fgoto string_impl; }
           )
-        | "\\" @{ fgoto string_impl; }
+        | "\\" @{ ps = nullptr; fgoto string_impl; }
         );
 
       string =
-        "\"" @{ ps = fpc + 1; }
-        ( "\"" @{ lua_pushlstring(L, ps, 0); }
+        "\"" @{ ps = fpc + 1; pq = fpc; if (const char* q = scan_json_string_last(ps, pe)) { fexec q; } }
+        ( "\"" @{ handler.string(ps, fpc); ps = nullptr; }
         | unescaped+
-          ( "\"" @{ lua_pushlstring(L, ps, fpc - ps); }
-          | "\\" @{ size_t n = fpc - ps; buffer.resize(n); memcpy(buffer.data(), ps, n); fcall string_impl; }
+          ( "\"" @{ if (carry.empty()) { handler.string(ps, fpc); } else { buffer.clear(); append_token(buffer, carry, ps, fpc); handler.escaped_string(pq, fpc + 1, buffer); } ps = nullptr; }
+          | "\\" @{ buffer.clear(); append_token(buffer, carry, ps, fpc); ps = nullptr; fcall string_impl; }
           )
-        | "\\" @{ buffer.clear(); fcall string_impl; }
+        | "\\" @{ buffer.clear(); ps = nullptr; fcall string_impl; }
         );
 
       value =
-        ( "false" @{ lua_pushboolean(L, false); }
-        | "null" @{ if (null_index) { lua_pushvalue(L, null_index); } else { lua_pushnil(L); } }
-        | "true" @{ lua_pushboolean(L, true); }
-        | "{" @{ lua_checkstack(L, 3); lua_createtable(L, 0, 8); fcall object; }
-        | "[" @{ lua_checkstack(L, 2); lua_createtable(L, 8, 0); array_stack.push_back(0); fcall array; }
+        ( "false" @{ handler.literal(json_false); }
+        | "null" @{ handler.literal(json_null); }
+        | "true" @{ handler.literal(json_true); }
+        | "{" @{ if (stack.size() >= json_max_depth) { fgoto *0; } handler.begin_object(); fcall object; }
+        | "[" @{ if (stack.size() >= json_max_depth) { fgoto *0; } handler.begin_array(); fcall array; }
         | number
         | string
         );
 
-      member = ws string ws ":" ws value %{ lua_rawset(L, -3); };
-      object := (member (ws "," member)*)? ws "}" @{ fret; };
-      element = ws value %{ lua_rawseti(L, -2, ++array_stack.back()); };
-      array := (element (ws "," element)*)? ws "]" @{ lua_pushvalue(L, array_index); lua_setmetatable(L, -2); array_stack.pop_back(); fret; };
+      member = ws string ws ":" ws value %{ handler.member(); };
+      object := (member (ws "," member)*)? ws "}" @{ handler.end_object(); fret; };
+      element = ws value %{ handler.element(); };
+      array := (element (ws "," element)*)? ws "]" @{ handler.end_array(); fret; };
       main := ws value ws;
 
       write data noerror nofinal noentry;
     }%%
+  }
+
+  bool parse_json_number(const char* data, size_t size, bool terminated, bool& is_int, lua_Integer& integer, double& number, std::vector<char>& buffer) {
+    const char* const data_end = data + size;
+
+    if (is_int) {
+      const char* ptr = data;
+      lua_unsigned_t negative = 0;
+      if (*ptr == '-') {
+        negative = 1;
+        ++ptr;
+      }
+      size_t n = data_end - ptr;
+      if (n <= integer_digs) {
+        uint64_t u = parse_digits(ptr, n);
+        if (u <= integer_max + negative) {
+          lua_unsigned_t v = static_cast<lua_unsigned_t>(u);
+          integer = static_cast<lua_Integer>(negative ? 0 - v : v);
+          return true;
+        }
+      }
+      is_int = false;
+    }
+
+    // parse_double() gives up only if the number has too many significant
+    // digits or is too close to a rounding boundary.
+    if (parse_double(data, data_end, number)) {
+      return true;
+    }
+
+    // At the end-of-file, strtod() may not be able to find an unrecognized
+    // character, because the null termination is not guaranteed.
+    // Also, The decimal point is denpended to the locale. For example, the
+    // decimal point is ',' in the de_DE locale. In such a case, strtod() may
+    // read too small or too much.
+    char decimal_point = *localeconv()->decimal_point;
+    if (terminated && decimal_point == '.') {
+      char* end = nullptr;
+      number = strtod(data, &end);
+      return end == data_end;
+    }
+
+    buffer.resize(size + 1);
+    char* ptr = buffer.data();
+    memcpy(ptr, data, size);
+    ptr[size] = '\0';
+    if (decimal_point != '.') {
+      if (char* q = strchr(ptr, '.')) {
+        *q = decimal_point;
+      }
+    }
+
+    char* end = nullptr;
+    number = strtod(ptr, &end);
+    return end == ptr + size;
+  }
 
 #ifdef __GNUC__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wimplicit-fallthrough"
 #endif
 
-    int impl_parse(lua_State* L) {
-      data_t data = check_data(L, 1);
+  json_value_handler_t::json_value_handler_t(lua_State* L, int null_index, int array_index, json_parse_state_t& state)
+    : L_(L),
+      null_index_(null_index),
+      array_index_(array_index),
+      state_(state) {}
+
+  void json_value_handler_t::literal(json_type_t type) {
+    if (type == json_null) {
+      if (null_index_) {
+        lua_pushvalue(L_, null_index_);
+      } else {
+        lua_pushnil(L_);
+      }
+    } else {
+      lua_pushboolean(L_, type == json_true);
+    }
+  }
 
-      int cs = 0;
-      int top = lua_gettop(L);
+  bool json_value_handler_t::number(const char* data, size_t size, bool is_int, bool terminated) {
+    lua_Integer integer = 0;
+    double number = 0;
+    if (!parse_json_number(data, size, terminated, is_int, integer, number, state_.buffer)) {
+      return false;
+    }
+    if (is_int) {
+      lua_pushinteger(L_, integer);
+    } else {
+      lua_pushnumber(L_, number);
+    }
+    return true;
+  }
 
-      int null_index = top >= 2 ? 2 : 0;
-      luaL_getmetatable(L, "brigid.json.array");
-      int array_index = top + 1;
+  void json_value_handler_t::string(const char* ps, const char* pe) {
+    push_json_unescaped(L_, ps, pe - ps, state_);
+  }
+
+  void json_value_handler_t::escaped_string(const char*, const char*, const std::vector<char>& buffer) {
+    lua_pushlstring(L_, buffer.data(), buffer.size());
+  }
+
+  void json_value_handler_t::begin_object() {
+    lua_checkstack(L_, 3);
+    lua_createtable(L_, 0, 8);
+  }
+
+  void json_value_handler_t::end_object() {}
+
+  void json_value_handler_t::begin_array() {
+    lua_checkstack(L_, 2);
+    lua_createtable(L_, 8, 0);
+    state_.array_stack.push_back(0);
+  }
+
+  void json_value_handler_t::end_array() {
+    lua_pushvalue(L_, array_index_);
+    lua_setmetatable(L_, -2);
+    state_.array_stack.pop_back();
+  }
+
+  // A key must be a string even if it is pushed as a view.
+  void json_value_handler_t::member() {
+    if (state_.view_threshold) {
+      if (view_t* view = to_udata<view_t>(L_, -2, "brigid.view")) {
+        lua_pushlstring(L_, view->data(), view->size());
+        lua_replace(L_, -3);
+      }
+    }
+    lua_rawset(L_, -3);
+  }
 
-      %%write init;
+  void json_value_handler_t::element() {
+    lua_rawseti(L_, -2, ++state_.array_stack.back());
+  }
+
+  namespace {
+    // Appends the nodes to the tape. The positions are relative to pb, and
+    // the decoded strings are appended to strings. It does not use Lua, so
+    // that it can be used from any thread.
+    class json_tape_builder_t final : public json_handler_t {
+    public:
+      json_tape_builder_t(const char* pb, std::vector<json_node_t>& nodes, std::vector<char>& strings)
+        : pb_(pb),
+          nodes_(nodes),
+          strings_(strings) {}
+
+      virtual void literal(json_type_t type) {
+        push_node(type, 0, 0);
+      }
+
+      virtual bool number(const char* data, size_t size, bool is_int, bool) {
+        nodes_[push_node(json_number, data - pb_, size)].is_int = is_int;
+        return true;
+      }
+
+      virtual void string(const char* ps, const char* pe) {
+        push_node(json_string, ps - pb_, pe - ps);
+      }
 
-      const char* const pb = data.data();
+      virtual void escaped_string(const char*, const char*, const std::vector<char>& buffer) {
+        nodes_[push_node(json_string, strings_.size(), buffer.size())].escaped = true;
+        strings_.insert(strings_.end(), buffer.begin(), buffer.end());
+      }
+
+      virtual void begin_object() {
+        stack_.push_back(push_node(json_object, 0, 0));
+      }
+
+      virtual void end_object() {
+        end_node();
+      }
+
+      virtual void begin_array() {
+        stack_.push_back(push_node(json_array, 0, 0));
+      }
+
+      virtual void end_array() {
+        end_node();
+      }
+
+      virtual void member() {
+        ++nodes_[stack_.back()].count;
+      }
+
+      virtual void element() {
+        ++nodes_[stack_.back()].count;
+      }
+
+    private:
+      const char* pb_;
+      std::vector<json_node_t>& nodes_;
+      std::vector<char>& strings_;
+      std::vector<size_t> stack_;
+
+      size_t push_node(json_type_t type, size_t offset, size_t size) {
+        size_t index = nodes_.size();
+        json_node_t node = { type, false, false, offset, size, index + 1, 0 };
+        nodes_.push_back(node);
+        return index;
+      }
+
+      void end_node() {
+        nodes_[stack_.back()].end = nodes_.size();
+        stack_.pop_back();
+      }
+    };
+
+    void start_json_value(json_parse_state_t& state) {
+      state.cs = json_parser_start;
+      state.top = 0;
+      state.token = false;
+      state.stack.clear();
+      state.array_stack.clear();
+      state.carry.clear();
+    }
+
+    // Runs the machine from data to pe, and returns where it stops. The
+    // machine stops before pe if it finds an unexpected byte. Otherwise, it
+    // is suspended at pe and can be resumed by the next chunk.
+    template <class T>
+    const char* parse_json_chunk(T& handler, const char* data, const char* pe, bool end_of_stream, json_parse_state_t& state) {
+      int cs = state.cs;
+      int top = state.top;
+
+      const char* const pb = data;
       const char* p = pb;
-      const char* const pe = p + data.size();
-      const char* const eof = pe;
-      std::vector<int> stack; stack.reserve(16);
+      const char* const eof = end_of_stream ? pe : nullptr;
+      std::vector<int>& stack = state.stack;
 
-      const char* ps = nullptr;
-      std::vector<char> buffer;
-      std::vector<int> array_stack;
-      bool is_int = false;    // number is integer
-      char decimal_point = 0; // *localeconv()->decimal_point
-      uint32_t u = 0;         // unicode escape sequence
+      const char* ps = state.token ? p : nullptr;
+      const char* pq = nullptr;   // opening quote of the string
+      std::vector<char>& buffer = state.buffer;
+      std::vector<char>& carry = state.carry;
+      bool is_int = state.is_int; // number is integer
+      uint32_t u = state.u;       // unicode escape sequence
 
       %%write exec;
 
-      if (cs >= %%{ write first_final; }%% && stack.empty()) {
-        return 1;
+      if (ps && p == pe) {
+        carry.insert(carry.end(), ps, pe);
       }
+      state.cs = cs;
+      state.top = top;
+      state.token = ps != nullptr;
+      state.is_int = is_int;
+      state.u = u;
+      return p;
+    }
+
+    template <class T>
+    void parse_json_impl(T& handler, const char* data, size_t size, json_parse_state_t& state) {
+      start_json_value(state);
+      state.position = 0;
+      const char* p = parse_json_chunk(handler, data, data + size, true, state);
+
+      if (state.cs >= %%{ write first_final; }%% && state.stack.empty()) {
+        return;
+      }
+
+      std::ostringstream out;
+      out << "cannot parse json at position " << (p - data + 1);
+      throw BRIGID_RUNTIME_ERROR(out.str());
+    }
+  }
+
+  void parse_json(lua_State* L, const char* data, size_t size, int null_index, int array_index, json_parse_state_t& state) {
+    json_value_handler_t handler(L, null_index, array_index, state);
+    parse_json_impl(handler, data, size, state);
+  }
+
+  void parse_json(json_handler_t& handler, const char* data, size_t size) {
+    json_parse_state_t state;
+    parse_json_impl(handler, data, size, state);
+  }
 
+  // Parses the top-level values of a stream, which are separated by
+  // whitespace if needed. Returns true if a value is completed and pushed,
+  // and advances data past it. Otherwise, the chunk is consumed and the
+  // partially built values are kept on the stack of L.
+  bool parse_json_stream(lua_State* L, const char*& data, const char* pe, bool end_of_stream, int null_index, int array_index, json_parse_state_t& state) {
+    if (state.cs == 0) {
+      start_json_value(state);
+      state.base = lua_gettop(L);
+    }
+    json_value_handler_t handler(L, null_index, array_index, state);
+    const char* p = parse_json_chunk(handler, data, pe, end_of_stream, state);
+    state.position += p - data;
+    data = p;
+
+    // The machine stops at the byte next to a completed value.
+    if (state.stack.empty() && lua_gettop(L) > state.base) {
+      state.cs = 0;
+      return true;
+    }
+    if (state.cs == 0 || (end_of_stream && state.cs != json_parser_start)) {
       std::ostringstream out;
-      out << "cannot parse json at position " << (p - pb + 1);
+      out << "cannot parse json at position " << (state.position + 1);
       throw BRIGID_RUNTIME_ERROR(out.str());
     }
+    return false;
+  }
+
+  void parse_json_tape(const char* data, size_t size, std::vector<json_node_t>& nodes, std::vector<char>& strings) {
+    nodes.clear();
+    strings.clear();
+    append_json_tape(data, size, nodes, strings);
+  }
+
+  void append_json_tape(const char* data, size_t size, std::vector<json_node_t>& nodes, std::vector<char>& strings) {
+    json_tape_builder_t builder(data, nodes, strings);
+    json_parse_state_t state;
+    parse_json_impl(builder, data, size, state);
+  }
 
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
+
+  void push_json_unescaped(lua_State* L, const char* data, size_t size, json_parse_state_t& state) {
+    if (state.view_threshold && size >= state.view_threshold) {
+      new_view(L, data, size, state.view_ref);
+    } else {
+      lua_pushlstring(L, data, size);
+    }
+  }
+
+  namespace {
+    int impl_parse(lua_State* L) {
+      data_t data = check_data(L, 1);
+
+      int top = lua_gettop(L);
+      int null_index = top >= 2 ? 2 : 0;
+      luaL_getmetatable(L, "brigid.json.array");
+      int array_index = top + 1;
+
+      json_projection_t projection;
+      if (top >= 3) {
+        if (get_field(L, 3, "keep") != LUA_TNIL) {
+          luaL_checktype(L, -1, LUA_TTABLE);
+          for (int i = 1; ; ++i) {
+            lua_rawgeti(L, -1, i);
+            size_t size = 0;
+            const char* path = lua_tolstring(L, -1, &size);
+            lua_pop(L, 1);
+            if (!path) {
+              break;
+            }
+            projection.add(path, size);
+          }
+        }
+        lua_pop(L, 1);
+      }
+
+      // The views refer to the bytes of a string source, which are not
+      // moved while the string is alive.
+      json_parse_state_t state;
+      if (top >= 3) {
+        if (get_field(L, 3, "view_threshold") != LUA_TNIL) {
+          state.view_threshold = check_integer<size_t>(L, -1);
+        }
+        lua_pop(L, 1);
+        if (state.view_threshold) {
+          if (lua_type(L, 1) != LUA_TSTRING) {
+            throw BRIGID_LOGIC_ERROR("view_threshold needs a string source");
+          }
+          state.view_ref = std::make_shared<view_reference_t>(L);
+          lua_pushvalue(L, 1);
+          lua_xmove(L, state.view_ref->get(), 1);
+        }
+      }
+
+      if (projection.empty()) {
+        parse_json(L, data.data(), data.size(), null_index, array_index, state);
+      } else {
+        // Parse into a tape and create the Lua values only for the kept
+        // members.
+        std::vector<json_node_t> nodes;
+        std::vector<char> strings;
+        parse_json_tape(data.data(), data.size(), nodes, strings);
+        push_json_projection(L, data.data(), strings.data(), nodes, 0, projection, 0, null_index, array_index, state);
+      }
+      return 1;
+    }
   }
 
   void initialize_json_parse(lua_State* L) {
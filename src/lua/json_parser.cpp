@@ -0,0 +1,166 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+#include "scope_exit.hpp"
+#include "thread_reference.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <utility>
+
+namespace brigid {
+  namespace {
+    // The parser keeps the machine of parse_json between chunks. The values
+    // being built are kept on the stack of the thread of the reference, and
+    // only the bytes of a token which is not completed are retained.
+    class json_parser_t : private noncopyable {
+    public:
+      json_parser_t(thread_reference&& ref, int null_index, int array_index)
+        : ref_(std::move(ref)),
+          null_index_(null_index),
+          array_index_(array_index),
+          running_() {}
+
+      void update(const char* data, size_t size, bool eof) {
+        try {
+          update_impl(data, size, eof);
+        } catch (...) {
+          reset();
+          throw;
+        }
+      }
+
+      void close() {
+        reset();
+        ref_ = thread_reference();
+      }
+
+      bool closed() const {
+        return !ref_;
+      }
+
+      bool running() const {
+        return running_;
+      }
+
+    private:
+      thread_reference ref_;
+      int null_index_;
+      int array_index_;
+      bool running_;
+      json_parse_state_t state_;
+
+      void reset() {
+        if (lua_State* L = ref_.get()) {
+          lua_settop(L, array_index_);
+        }
+        state_.cs = 0;
+        state_.position = 0;
+      }
+
+      void update_impl(const char* data, size_t size, bool eof) {
+        if (lua_State* L = ref_.get()) {
+          const char* p = data;
+          const char* const pe = p + size;
+          while (parse_json_stream(L, p, pe, eof, null_index_, array_index_, state_)) {
+            emit(L);
+          }
+          if (eof) {
+            reset();
+          }
+        }
+      }
+
+      void emit(lua_State* L) {
+        lua_pushvalue(L, 1);
+        lua_insert(L, -2);
+        running_ = true;
+        scope_exit scope_guard([&]() {
+          running_ = false;
+        });
+        if (lua_pcall(L, 1, 0, 0) != 0) {
+          throw BRIGID_RUNTIME_ERROR(lua_tostring(L, -1));
+        }
+      }
+    };
+
+    json_parser_t* check_json_parser(lua_State* L, int arg, int validate = check_validate_all) {
+      json_parser_t* self = check_udata<json_parser_t>(L, arg, "brigid.json.parser");
+      if (validate & check_validate_not_closed) {
+        if (self->closed()) {
+          luaL_argerror(L, arg, "attempt to use a closed brigid.json.parser");
+        }
+      }
+      if (validate & check_validate_not_running) {
+        if (self->running()) {
+          luaL_argerror(L, arg, "attempt to use a running brigid.json.parser");
+        }
+      }
+      return self;
+    }
+
+    void impl_gc(lua_State* L) {
+      check_json_parser(L, 1, check_validate_none)->~json_parser_t();
+    }
+
+    void impl_close(lua_State* L) {
+      json_parser_t* self = check_json_parser(L, 1, check_validate_not_running);
+      if (!self->closed()) {
+        self->close();
+      }
+    }
+
+    void impl_call(lua_State* L) {
+      luaL_checkany(L, 2);
+      bool has_null = lua_gettop(L) >= 3;
+
+      thread_reference ref(L);
+      lua_pushvalue(L, 2);
+      lua_xmove(L, ref.get(), 1);
+
+      int null_index = 0;
+      if (has_null) {
+        lua_pushvalue(L, 3);
+        lua_xmove(L, ref.get(), 1);
+        null_index = 2;
+      }
+
+      luaL_getmetatable(ref.get(), "brigid.json.array");
+      int array_index = lua_gettop(ref.get());
+
+      new_userdata<json_parser_t>(L, "brigid.json.parser", std::move(ref), null_index, array_index);
+    }
+
+    void impl_update(lua_State* L) {
+      json_parser_t* self = check_json_parser(L, 1);
+      data_t data = check_data(L, 2);
+      bool eof = lua_toboolean(L, 3);
+      self->update(data.data(), data.size(), eof);
+    }
+  }
+
+  void initialize_json_parser(lua_State* L) {
+    lua_newtable(L);
+    {
+      new_metatable(L, "brigid.json.parser");
+      lua_pushvalue(L, -2);
+      lua_setfield(L, -2, "__index");
+      decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+      decltype(function<impl_close>())::set_field(L, -1, "__close");
+      lua_pop(L, 1);
+
+      decltype(function<impl_call>())::set_metafield(L, -1, "__call");
+      decltype(function<impl_update>())::set_field(L, -1, "update");
+      decltype(function<impl_close>())::set_field(L, -1, "close");
+    }
+    lua_setfield(L, -2, "parser");
+  }
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "json.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    static const size_t npos = static_cast<size_t>(-1);
+  }
+
+  json_projection_t::json_projection_t() {
+    node_t root = { npos, std::string(), false };
+    nodes_.push_back(root);
+  }
+
+  void json_projection_t::add(const char* path, size_t size) {
+    const char* p = path;
+    const char* const pe = p + size;
+    size_t index = 0;
+    while (true) {
+      const char* q = static_cast<const char*>(memchr(p, '.', pe - p));
+      if (!q) {
+        q = pe;
+      }
+      size_t child = find(index, p, q - p);
+      if (child == npos) {
+        child = nodes_.size();
+        node_t node = { index, std::string(p, q), false };
+        nodes_.push_back(node);
+      }
+      index = child;
+      if (q == pe) {
+        break;
+      }
+      p = q + 1;
+    }
+    nodes_[index].all = true;
+  }
+
+  size_t json_projection_t::find(size_t index, const char* key, size_t size) const {
+    for (size_t i = index + 1; i < nodes_.size(); ++i) {
+      const node_t& node = nodes_[i];
+      if (node.parent == index && node.key.size() == size && memcmp(node.key.data(), key, size) == 0) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+  bool json_projection_t::all(size_t index) const {
+    return nodes_[index].all;
+  }
+
+  bool json_projection_t::empty() const {
+    return nodes_.size() == 1;
+  }
+
+  // Pushes the value of the node at index projected by the projection node
+  // at position. The members not in the projection are skipped on the tape,
+  // so that no Lua values are created for them. The projection is applied to
+  // each element of an array. A scalar is pushed as it is. The recursion is
+  // bounded by json_max_depth which the tape builder enforces.
+  void push_json_projection(lua_State* L, const char* data, const char* strings, const std::vector<json_node_t>& nodes, size_t index, const json_projection_t& projection, size_t position, int null_index, int array_index, json_parse_state_t& state) {
+    const json_node_t& node = nodes[index];
+    if (projection.all(position) || (node.type != json_object && node.type != json_array)) {
+      push_json_tape(L, data, strings, nodes, index, null_index, array_index, state);
+      return;
+    }
+
+    lua_checkstack(L, 3);
+    if (node.type == json_object) {
+      lua_newtable(L);
+      for (size_t i = index + 1; i < node.end; i = nodes[i + 1].end) {
+        const json_node_t& key = nodes[i];
+        size_t child = projection.find(position, get_json_string(data, strings, key), key.size);
+        if (child == npos) {
+          continue;
+        }
+        push_json_string(L, data, strings, key);
+        push_json_projection(L, data, strings, nodes, i + 1, projection, child, null_index, array_index, state);
+        lua_rawset(L, -3);
+      }
+    } else {
+      lua_createtable(L, static_cast<int>(node.count), 0);
+      lua_pushvalue(L, array_index);
+      lua_setmetatable(L, -2);
+      lua_Integer n = 0;
+      for (size_t i = index + 1; i < node.end; i = nodes[i].end) {
+        push_json_projection(L, data, strings, nodes, i, projection, position, null_index, array_index, state);
+        lua_rawseti(L, -2, ++n);
+      }
+    }
+  }
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "function.hpp"
+#include "json.hpp"
+#include "noncopyable.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <string>
+
+namespace brigid {
+  namespace {
+    // A serialized JSON text which write_json writes as it is. The source is
+    // copied, so that the fragment can be cached and reused.
+    class json_raw_t : private noncopyable {
+    public:
+      json_raw_t(const char* data, size_t size)
+        : data_(data, size) {}
+
+      const char* data() const {
+        return data_.data();
+      }
+
+      size_t size() const {
+        return data_.size();
+      }
+
+    private:
+      std::string data_;
+    };
+
+    json_raw_t* check_json_raw(lua_State* L, int arg) {
+      return check_udata<json_raw_t>(L, arg, "brigid.json.raw");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_json_raw(L, 1)->~json_raw_t();
+    }
+
+    void impl_get_size(lua_State* L) {
+      json_raw_t* self = check_json_raw(L, 1);
+      push_integer(L, self->size());
+    }
+
+    void impl_get_string(lua_State* L) {
+      json_raw_t* self = check_json_raw(L, 1);
+      lua_pushlstring(L, self->data(), self->size());
+    }
+
+    // If check is true, the source is validated once here.
+    void impl_raw(lua_State* L) {
+      data_t data = check_data(L, 1);
+      if (lua_toboolean(L, 2)) {
+        validate_json(data.data(), data.size());
+      }
+      new_userdata<json_raw_t>(L, "brigid.json.raw", data.data(), data.size());
+    }
+  }
+
+  data_t to_json_raw(lua_State* L, int index) {
+    if (const json_raw_t* self = to_udata<json_raw_t>(L, index, "brigid.json.raw")) {
+      return data_t(self->data(), self->size());
+    }
+    return data_t();
+  }
+
+  void initialize_json_raw(lua_State* L) {
+    new_metatable(L, "brigid.json.raw");
+    decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+    decltype(function<impl_get_size>())::set_field(L, -1, "__len");
+    decltype(function<impl_get_string>())::set_field(L, -1, "__tostring");
+    lua_pop(L, 1);
+
+    decltype(function<impl_raw>())::set_field(L, -1, "raw");
+  }
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "error.hpp"
+#include "json.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <vector>
+
+namespace brigid {
+  namespace {
+    // The source next to the number is not known to be terminated.
+    void push_json_number(lua_State* L, const char* data, const json_node_t& node, json_parse_state_t& state) {
+      bool is_int = node.is_int;
+      lua_Integer integer = 0;
+      double number = 0;
+      if (!parse_json_number(data + node.offset, node.size, false, is_int, integer, number, state.buffer)) {
+        throw BRIGID_RUNTIME_ERROR("cannot strtod");
+      }
+      if (is_int) {
+        lua_pushinteger(L, integer);
+      } else {
+        lua_pushnumber(L, number);
+      }
+    }
+  }
+
+  void push_json_string(lua_State* L, const char* data, const char* strings, const json_node_t& node) {
+    lua_pushlstring(L, get_json_string(data, strings, node), node.size);
+  }
+
+  // Pushes the value of the node at index. The tables are created with the
+  // exact sizes from the tape, and the scalars are converted without
+  // parsing the source again.
+  void push_json_tape(lua_State* L, const char* data, const char* strings, const std::vector<json_node_t>& nodes, size_t index, int null_index, int array_index, json_parse_state_t& state) {
+    struct frame_t {
+      size_t index;
+      lua_Integer n;
+    };
+    std::vector<frame_t> stack;
+
+    size_t i = index;
+    while (true) {
+      if (!stack.empty() && nodes[stack.back().index].type == json_object) {
+        push_json_string(L, data, strings, nodes[i++]);
+      }
+
+      const json_node_t& node = nodes[i];
+      switch (node.type) {
+        case json_null:
+          if (null_index) {
+            lua_pushvalue(L, null_index);
+          } else {
+            lua_pushnil(L);
+          }
+          break;
+        case json_false:
+          lua_pushboolean(L, false);
+          break;
+        case json_true:
+          lua_pushboolean(L, true);
+          break;
+        case json_number:
+          push_json_number(L, data, node, state);
+          break;
+        case json_string:
+          if (node.escaped) {
+            push_json_string(L, data, strings, node);
+          } else {
+            push_json_unescaped(L, data + node.offset, node.size, state);
+          }
+          break;
+        case json_object:
+          lua_checkstack(L, 3);
+          lua_createtable(L, 0, static_cast<int>(node.count));
+          break;
+        case json_array:
+          lua_checkstack(L, 2);
+          lua_createtable(L, static_cast<int>(node.count), 0);
+          lua_pushvalue(L, array_index);
+          lua_setmetatable(L, -2);
+          break;
+      }
+
+      if (node.count > 0) {
+        frame_t frame = { i++, 0 };
+        stack.push_back(frame);
+        continue;
+      }
+      ++i;
+
+      // The value on the top of the stack is completed.
+      while (true) {
+        if (stack.empty()) {
+          return;
+        }
+        frame_t& frame = stack.back();
+        if (nodes[frame.index].type == json_object) {
+          lua_rawset(L, -3);
+        } else {
+          lua_rawseti(L, -2, ++frame.n);
+        }
+        if (i != nodes[frame.index].end) {
+          break;
+        }
+        stack.pop_back();
+      }
+    }
+  }
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "function.hpp"
+#include "memory.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <algorithm>
+#include <memory>
+
+namespace brigid {
+  namespace {
+    // The growth smaller than this is not reported. The growth is not
+    // decreased below zero, so that a released buffer does not hide the
+    // next one.
+    static const ptrdiff_t report_threshold = 1024 * 1024;
+
+    const char* memory_type_names[] = {
+      "buffer_pool",
+      "cryptor",
+      "data_writer",
+      "file_writer",
+      "view",
+    };
+
+    using memory_usage_reference_t = std::shared_ptr<memory_usage_t>;
+
+    memory_usage_reference_t* check_memory_usage_reference(lua_State* L, int arg) {
+      return check_udata<memory_usage_reference_t>(L, arg, "brigid.memory_usage");
+    }
+
+    void impl_gc(lua_State* L) {
+      check_memory_usage_reference(L, 1)->~memory_usage_reference_t();
+    }
+
+    void impl_memory_stats(lua_State* L) {
+      std::shared_ptr<memory_usage_t> usage = get_memory_usage(L);
+      size_t total = 0;
+      lua_createtable(L, 0, memory_type_max + 1);
+      for (int i = 0; i < memory_type_max; ++i) {
+        size_t size = usage->get(static_cast<memory_type_t>(i));
+        push_integer(L, size);
+        lua_setfield(L, -2, memory_type_names[i]);
+        total += size;
+      }
+      push_integer(L, total);
+      lua_setfield(L, -2, "total");
+    }
+  }
+
+  namespace detail {
+    thread_local memory_usage_t* memory_usage_to_report = nullptr;
+  }
+
+  memory_usage_t::memory_usage_t()
+    : usage_(),
+      growth_() {}
+
+  void memory_usage_t::increase(memory_type_t type, size_t size) {
+    usage_[type] += size;
+    if (type != memory_view) {
+      growth_ += static_cast<ptrdiff_t>(size);
+      if (growth_ >= report_threshold) {
+        detail::memory_usage_to_report = this;
+      }
+    }
+  }
+
+  void memory_usage_t::decrease(memory_type_t type, size_t size) {
+    usage_[type] -= size;
+    if (type != memory_view) {
+      growth_ = std::max<ptrdiff_t>(growth_ - static_cast<ptrdiff_t>(size), 0);
+    }
+  }
+
+  void memory_usage_t::move(memory_type_t from, memory_type_t to, size_t size) {
+    usage_[from] -= size;
+    usage_[to] += size;
+  }
+
+  size_t memory_usage_t::get(memory_type_t type) const {
+    return usage_[type];
+  }
+
+  ptrdiff_t memory_usage_t::take_growth() {
+    ptrdiff_t growth = growth_;
+    growth_ = 0;
+    return growth;
+  }
+
+  // The counters are kept in the registry, and shared by the coroutines of
+  // the state.
+  std::shared_ptr<memory_usage_t> get_memory_usage(lua_State* L) {
+    lua_getfield(L, LUA_REGISTRYINDEX, "brigid.memory_usage_of_state");
+    std::shared_ptr<memory_usage_t> usage = *to_udata<memory_usage_reference_t>(L, -1, "brigid.memory_usage");
+    lua_pop(L, 1);
+    return usage;
+  }
+
+  void report_memory_usage(lua_State* L) {
+    if (memory_usage_t* usage = detail::memory_usage_to_report) {
+      detail::memory_usage_to_report = nullptr;
+      ptrdiff_t growth = usage->take_growth();
+      if (growth > 0) {
+        lua_gc(L, LUA_GCSTEP, static_cast<int>(std::min<ptrdiff_t>(growth / 1024, 0x7FFFFFFF)));
+      }
+    }
+  }
+
+  void initialize_memory(lua_State* L) {
+    new_metatable(L, "brigid.memory_usage");
+    decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+    lua_pop(L, 1);
+
+    new_userdata<memory_usage_reference_t>(L, "brigid.memory_usage", std::make_shared<memory_usage_t>());
+    lua_setfield(L, LUA_REGISTRYINDEX, "brigid.memory_usage_of_state");
+
+    decltype(function<impl_memory_stats>())::set_field(L, -1, "memory_stats");
+  }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_MEMORY_HPP
+#define BRIGID_MEMORY_HPP
+
+#include "noncopyable.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <memory>
+
+namespace brigid {
+  enum memory_type_t {
+    memory_buffer_pool,
+    memory_cryptor,
+    memory_data_writer,
+    memory_file_writer,
+    memory_view,
+    memory_type_max,
+  };
+
+  // The native memory which is not allocated by lua_Alloc is counted per
+  // lua_State by its owner type, so that the garbage collector of the state
+  // can be told about it. An owner keeps the counters of the state which
+  // created it. The mapped pages of memory_view are counted but do not grow
+  // the debt of the garbage collector.
+  class memory_usage_t : private noncopyable {
+  public:
+    memory_usage_t();
+    void increase(memory_type_t, size_t);
+    void decrease(memory_type_t, size_t);
+    // Changes the owner type without growing the memory.
+    void move(memory_type_t, memory_type_t, size_t);
+    size_t get(memory_type_t) const;
+    ptrdiff_t take_growth();
+
+  private:
+    size_t usage_[memory_type_max];
+    ptrdiff_t growth_;
+  };
+
+  std::shared_ptr<memory_usage_t> get_memory_usage(lua_State*);
+
+  namespace detail {
+    extern thread_local memory_usage_t* memory_usage_to_report;
+  }
+
+  // Forgets the report requested in the outer call. The growth is kept and
+  // requested again by the next allocation. The functions registered by
+  // memory_function call this on entry, so that a report is never carried
+  // over to another call or another state.
+  inline void clear_memory_report() {
+    detail::memory_usage_to_report = nullptr;
+  }
+
+  // Steps the garbage collector in proportion to the native memory grown
+  // since the last report, if the growth reached the threshold during the
+  // call. The functions registered by memory_function call this after
+  // returning.
+  void report_memory_usage(lua_State*);
+}
+
+#endif
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019-2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -11,6 +11,8 @@
 #include <exception>
 
 namespace brigid {
+  void initialize_buffer_pool(lua_State*);
+  void initialize_cbor(lua_State*);
   void initialize_common(lua_State*);
   void initialize_cryptor(lua_State*);
   void initialize_data_writer(lua_State*);
@@ -19,10 +21,14 @@ namespace brigid {
   void initialize_hasher(lua_State*);
   void initialize_http(lua_State*);
   void initialize_json(lua_State*);
+  void initialize_memory(lua_State*);
+  void initialize_msgpack(lua_State*);
   void initialize_stopwatch(lua_State*);
   void initialize_view(lua_State*);
 
   void initialize(lua_State* L) {
+    initialize_buffer_pool(L);
+    initialize_cbor(L);
     initialize_common(L);
     initialize_cryptor(L);
     initialize_data_writer(L);
@@ -31,6 +37,8 @@ namespace brigid {
     initialize_hasher(L);
     initialize_http(L);
     initialize_json(L);
+    initialize_memory(L);
+    initialize_msgpack(L);
     initialize_stopwatch(L);
     initialize_view(L);
 
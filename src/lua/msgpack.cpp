@@ -0,0 +1,170 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#include "common.hpp"
+#include "data.hpp"
+#include "decoder.hpp"
+#include "function.hpp"
+
+#include <lua.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace brigid {
+  namespace {
+    // Decodes a MessagePack value. Both str and bin are pushed as strings.
+    class msgpack_parser_t : private decoder_t {
+    public:
+      msgpack_parser_t(const char* data, size_t size, int null_index, int array_index)
+        : decoder_t("msgpack", data, size, null_index, array_index) {}
+
+      void parse(lua_State* L) {
+        push_value(L, 0);
+        if (p_ != pe_) {
+          error();
+        }
+      }
+
+    private:
+      void push_bytes(lua_State* L, size_t size) {
+        need(size);
+        lua_pushlstring(L, reinterpret_cast<const char*>(p_), size);
+        p_ += size;
+      }
+
+      void push_array(lua_State* L, size_t size, int depth) {
+        // Each element has at least one byte.
+        need(size);
+        new_array(L, static_cast<int>(size));
+        for (size_t i = 1; i <= size; ++i) {
+          push_value(L, depth + 1);
+          lua_rawseti(L, -2, i);
+        }
+      }
+
+      void push_map(lua_State* L, size_t size, int depth) {
+        need_pairs(size);
+        new_map(L, static_cast<int>(size));
+        for (size_t i = 0; i < size; ++i) {
+          const uint8_t* p = p_;
+          push_value(L, depth + 1);
+          check_key(L, p);
+          push_value(L, depth + 1);
+          lua_rawset(L, -3);
+        }
+      }
+
+      void push_value(lua_State* L, int depth) {
+        check_depth(depth);
+        need(1);
+        uint8_t c = *p_++;
+
+        if (c <= 0x7F) {
+          push_integer(L, c);
+          return;
+        } else if (c <= 0x8F) {
+          push_map(L, c & 0x0F, depth);
+          return;
+        } else if (c <= 0x9F) {
+          push_array(L, c & 0x0F, depth);
+          return;
+        } else if (c <= 0xBF) {
+          push_bytes(L, c & 0x1F);
+          return;
+        } else if (c >= 0xE0) {
+          push_integer(L, static_cast<int8_t>(c));
+          return;
+        }
+
+        switch (c) {
+          case 0xC0:
+            push_null(L);
+            return;
+          case 0xC2:
+            lua_pushboolean(L, false);
+            return;
+          case 0xC3:
+            lua_pushboolean(L, true);
+            return;
+          case 0xC4: case 0xD9:
+            push_bytes(L, read_uint(1));
+            return;
+          case 0xC5: case 0xDA:
+            push_bytes(L, read_uint(2));
+            return;
+          case 0xC6: case 0xDB:
+            push_bytes(L, read_uint(4));
+            return;
+          case 0xCA:
+            push_float(L);
+            return;
+          case 0xCB:
+            push_double(L);
+            return;
+          case 0xCC:
+            push_integer(L, static_cast<uint8_t>(read_uint(1)));
+            return;
+          case 0xCD:
+            push_integer(L, static_cast<uint16_t>(read_uint(2)));
+            return;
+          case 0xCE:
+            push_integer(L, static_cast<uint32_t>(read_uint(4)));
+            return;
+          case 0xCF:
+            push_integer(L, read_uint(8));
+            return;
+          case 0xD0:
+            push_integer(L, static_cast<int8_t>(read_uint(1)));
+            return;
+          case 0xD1:
+            push_integer(L, static_cast<int16_t>(read_uint(2)));
+            return;
+          case 0xD2:
+            push_integer(L, static_cast<int32_t>(read_uint(4)));
+            return;
+          case 0xD3:
+            push_integer(L, static_cast<int64_t>(read_uint(8)));
+            return;
+          case 0xDC:
+            push_array(L, read_uint(2), depth);
+            return;
+          case 0xDD:
+            push_array(L, read_uint(4), depth);
+            return;
+          case 0xDE:
+            push_map(L, read_uint(2), depth);
+            return;
+          case 0xDF:
+            push_map(L, read_uint(4), depth);
+            return;
+        }
+
+        // 0xC1 is never used, and the extension types are not supported.
+        --p_;
+        error();
+      }
+    };
+
+    int impl_parse(lua_State* L) {
+      data_t data = check_data(L, 1);
+
+      int top = lua_gettop(L);
+      int null_index = top >= 2 ? 2 : 0;
+      luaL_getmetatable(L, "brigid.json.array");
+      int array_index = top + 1;
+
+      msgpack_parser_t(data.data(), data.size(), null_index, array_index).parse(L);
+      return 1;
+    }
+  }
+
+  void initialize_msgpack(lua_State* L) {
+    lua_newtable(L);
+    {
+      decltype(function<impl_parse>())::set_field(L, -1, "parse");
+    }
+    lua_setfield(L, -2, "msgpack");
+  }
+}
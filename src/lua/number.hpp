@@ -0,0 +1,51 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_NUMBER_HPP
+#define BRIGID_NUMBER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace brigid {
+  namespace detail {
+    inline bool is_little_endian() {
+      const uint16_t value = 1;
+      uint8_t byte = 0;
+      memcpy(&byte, &value, 1);
+      return byte == 1;
+    }
+
+    // Converts eight ASCII digits at once.
+    inline uint64_t parse_eight_digits(const char* data) {
+      uint64_t v = 0;
+      memcpy(&v, data, 8);
+      v -= 0x3030303030303030;
+      v = (v * 10) + (v >> 8);
+      v = (((v & 0x000000FF000000FF) * 0x000F424000000064) + (((v >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+      return v;
+    }
+  }
+
+  // Converts at most 19 ASCII digits to an integer.
+  inline uint64_t parse_digits(const char* data, size_t size) {
+    uint64_t v = 0;
+    if (detail::is_little_endian()) {
+      for (; size >= 8; data += 8, size -= 8) {
+        v = v * 100000000 + detail::parse_eight_digits(data);
+      }
+    }
+    for (; size > 0; ++data, --size) {
+      v = v * 10 + static_cast<uint64_t>(*data - '0');
+    }
+    return v;
+  }
+
+  bool parse_double(const char*, const char*, double&);
+  char* format_integer(int64_t, char*);
+  char* format_double(double, char*);
+}
+
+#endif
@@ -0,0 +1,170 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_SCAN_HPP
+#define BRIGID_SCAN_HPP
+
+#include <stdint.h>
+
+// BRIGID_NO_SIMD forces the scalar scanners.
+#if !defined(BRIGID_NO_SIMD) && defined(__AVX2__)
+#define BRIGID_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if !defined(BRIGID_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BRIGID_SCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace brigid {
+  namespace detail {
+    inline int count_trailing_zeros(uint32_t value) {
+#ifdef _MSC_VER
+      unsigned long result = 0;
+      _BitScanForward(&result, value);
+      return static_cast<int>(result);
+#else
+      return __builtin_ctz(value);
+#endif
+    }
+
+#ifdef BRIGID_SCAN_AVX2
+    inline uint32_t match_json_string_avx2(const char* p) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      __m256i m = _mm256_or_si256(
+          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+      return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+    }
+#endif
+
+#ifdef BRIGID_SCAN_SSE2
+    inline __m128i match_json_string_sse2(const char* p) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      return _mm_or_si128(
+          _mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+          _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    }
+#endif
+
+#ifdef BRIGID_SCAN_AVX2
+    inline uint32_t match_json_escape_avx2(const char* p) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      __m256i m = _mm256_or_si256(
+          _mm256_or_si256(
+              _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+              _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+          _mm256_or_si256(
+              _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7F)),
+              _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1F)), v)));
+      return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+    }
+#endif
+
+#ifdef BRIGID_SCAN_SSE2
+    inline uint32_t match_json_escape_sse2(const char* p) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i m = _mm_or_si128(
+          _mm_or_si128(
+              _mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+              _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+          _mm_or_si128(
+              _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7F)),
+              _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v)));
+      return static_cast<uint32_t>(_mm_movemask_epi8(m));
+    }
+#endif
+
+    inline bool is_json_escape(char c) {
+      unsigned char u = static_cast<unsigned char>(c);
+      return u <= 0x1F || u == '"' || u == '\\' || u == 0x7F;
+    }
+
+    inline const char* scan_json_string_scalar(const char* p, const char* pe) {
+      for (; p != pe; ++p) {
+        if (*p == '"' || *p == '\\') {
+          return p;
+        }
+      }
+      return pe;
+    }
+
+    inline const char* scan_json_escape_scalar(const char* p, const char* pe) {
+      for (; p != pe; ++p) {
+        if (is_json_escape(*p)) {
+          return p;
+        }
+      }
+      return pe;
+    }
+  }
+
+  // Returns the first '"' or '\\' in [p, pe), or pe if not found.
+  inline const char* scan_json_string(const char* p, const char* pe) {
+#if defined(BRIGID_SCAN_AVX2)
+    for (; pe - p >= 64; p += 64) {
+      uint32_t mask0 = detail::match_json_string_avx2(p);
+      uint32_t mask1 = detail::match_json_string_avx2(p + 32);
+      if (mask0) {
+        return p + detail::count_trailing_zeros(mask0);
+      }
+      if (mask1) {
+        return p + 32 + detail::count_trailing_zeros(mask1);
+      }
+    }
+#elif defined(BRIGID_SCAN_SSE2)
+    for (; pe - p >= 64; p += 64) {
+      __m128i m0 = detail::match_json_string_sse2(p);
+      __m128i m1 = detail::match_json_string_sse2(p + 16);
+      __m128i m2 = detail::match_json_string_sse2(p + 32);
+      __m128i m3 = detail::match_json_string_sse2(p + 48);
+      if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3)))) {
+        break;
+      }
+    }
+#endif
+#if defined(BRIGID_SCAN_SSE2)
+    for (; pe - p >= 16; p += 16) {
+      if (uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(detail::match_json_string_sse2(p)))) {
+        return p + detail::count_trailing_zeros(mask);
+      }
+    }
+#endif
+    return detail::scan_json_string_scalar(p, pe);
+  }
+
+  // Returns the first character which write_json_string escapes in [p, pe),
+  // or pe if not found.
+  inline const char* scan_json_escape(const char* p, const char* pe) {
+#if defined(BRIGID_SCAN_AVX2)
+    for (; pe - p >= 32; p += 32) {
+      if (uint32_t mask = detail::match_json_escape_avx2(p)) {
+        return p + detail::count_trailing_zeros(mask);
+      }
+    }
+#endif
+#if defined(BRIGID_SCAN_SSE2)
+    for (; pe - p >= 16; p += 16) {
+      if (uint32_t mask = detail::match_json_escape_sse2(p)) {
+        return p + detail::count_trailing_zeros(mask);
+      }
+    }
+#endif
+    return detail::scan_json_escape_scalar(p, pe);
+  }
+
+  // Returns the last position of the run of characters other than '"' and
+  // '\\' which starts at p, or nullptr if the run is empty.
+  inline const char* scan_json_string_last(const char* p, const char* pe) {
+    const char* q = scan_json_string(p, pe);
+    return q == p ? nullptr : q - 1;
+  }
+}
+
+#endif
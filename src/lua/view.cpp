@@ -1,13 +1,26 @@
-// Copyright (c) 2019,2021,2024 <dev@brigid.jp>
+// Copyright (c) 2019,2021,2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "common.hpp"
 #include "function.hpp"
 #include "view.hpp"
 
 #include <lua.hpp>
 
+#include <stdint.h>
+#include <memory>
+
+#ifdef _MSC_VER
+#include "view_map_windows.hpp"
+#else
+#include "view_map_unix.hpp"
+#endif
+
 namespace brigid {
   namespace {
     view_t* check_view(lua_State* L, int arg) {
@@ -18,6 +31,10 @@ namespace brigid {
       return self;
     }
 
+    void impl_gc(lua_State* L) {
+      check_udata<view_t>(L, 1, "brigid.view")->~view_t();
+    }
+
     void impl_get_pointer(lua_State* L) {
       view_t* self = check_view(L, 1);
       push_pointer(L, self->data());
@@ -32,21 +49,59 @@ namespace brigid {
       view_t* self = check_view(L, 1);
       lua_pushlstring(L, self->data(), self->size());
     }
+
+    void impl_close(lua_State* L) {
+      view_t* self = check_udata<view_t>(L, 1, "brigid.view");
+      if (!self->closed()) {
+        self->close();
+      }
+    }
+
+    // Maps the range of the file to a read-only view. If the size is
+    // omitted, the range extends to the end of the file. The file must not
+    // be truncated while the view is alive; on POSIX, reading the lost
+    // pages raises SIGBUS.
+    void impl_map(lua_State* L) {
+      const char* path = luaL_checkstring(L, 1);
+      uint64_t offset = opt_integer<uint64_t>(L, 2, 0);
+      uint64_t size = lua_isnoneornil(L, 3) ? map_to_end : check_integer<uint64_t>(L, 3);
+      std::shared_ptr<mapped_file_t> file = std::make_shared<mapped_file_t>(path, offset, size, get_memory_usage(L));
+      new_view(L, file->data(), file->size(), file);
+    }
   }
 
   abstract_data_t* to_abstract_data_view(lua_State* L, int arg) {
     return to_udata<view_t>(L, arg, "brigid.view");
   }
 
+  view_source_t::~view_source_t() {}
+
+  bool view_source_t::expired() const {
+    return false;
+  }
+
+  view_reference_t::view_reference_t(lua_State* L)
+    : ref_(L) {}
+
+  lua_State* view_reference_t::get() const {
+    return ref_.get();
+  }
+
   view_t::view_t(const char* data, size_t size)
     : data_(data),
       size_(size) {}
 
+  // The view shares the source, which is released by close.
+  view_t::view_t(const char* data, size_t size, const std::shared_ptr<view_source_t>& source)
+    : data_(data),
+      size_(size),
+      source_(source) {}
+
   bool view_t::closed() const {
-    return !data_;
+    return !data_ || (source_ && source_->expired());
   }
 
-  const char* view_t::data() const {
+  const char* view_t::data() {
     return data_;
   }
 
@@ -57,18 +112,25 @@ namespace brigid {
   void view_t::close() {
     data_ = nullptr;
     size_ = 0;
+    source_ = nullptr;
   }
 
   view_t* new_view(lua_State* L, const char* data, size_t size) {
     return new_userdata<view_t>(L, "brigid.view", data, size);
   }
 
+  view_t* new_view(lua_State* L, const char* data, size_t size, const std::shared_ptr<view_source_t>& source) {
+    return new_userdata<view_t>(L, "brigid.view", data, size, source);
+  }
+
   void initialize_view(lua_State* L) {
     lua_newtable(L);
     {
       new_metatable(L, "brigid.view");
       lua_pushvalue(L, -2);
       lua_setfield(L, -2, "__index");
+      decltype(function<impl_gc>())::set_field(L, -1, "__gc");
+      decltype(function<impl_close>())::set_field(L, -1, "__close");
       decltype(function<impl_get_size>())::set_field(L, -1, "__len");
       decltype(function<impl_get_string>())::set_field(L, -1, "__tostring");
       lua_pop(L, 1);
@@ -76,6 +138,8 @@ namespace brigid {
       decltype(function<impl_get_pointer>())::set_field(L, -1, "get_pointer");
       decltype(function<impl_get_size>())::set_field(L, -1, "get_size");
       decltype(function<impl_get_string>())::set_field(L, -1, "get_string");
+      decltype(function<impl_close>())::set_field(L, -1, "close");
+      decltype(function<impl_map>())::set_field(L, -1, "map");
     }
     lua_setfield(L, -2, "view");
   }
@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2021 <dev@brigid.jp>
+// Copyright (c) 2019-2021,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -7,25 +7,47 @@
 
 #include "data.hpp"
 #include "noncopyable.hpp"
+#include "thread_reference.hpp"
 
 #include <lua.hpp>
 
 #include <stddef.h>
+#include <memory>
 
 namespace brigid {
+  // A source keeps the data of its views alive. The views are closed when
+  // the source is expired.
+  class view_source_t {
+  public:
+    virtual ~view_source_t();
+    virtual bool expired() const;
+  };
+
+  // Keeps a Lua value alive in the reference thread.
+  class view_reference_t : public view_source_t, private noncopyable {
+  public:
+    explicit view_reference_t(lua_State*);
+    lua_State* get() const;
+  private:
+    thread_reference ref_;
+  };
+
   class view_t : public abstract_data_t, private noncopyable {
   public:
     view_t(const char*, size_t);
+    view_t(const char*, size_t, const std::shared_ptr<view_source_t>&);
     virtual bool closed() const;
-    virtual const char* data() const;
+    virtual const char* data();
     virtual size_t size() const;
     void close();
   private:
     const char* data_;
     size_t size_;
+    std::shared_ptr<view_source_t> source_;
   };
 
   view_t* new_view(lua_State*, const char*, size_t);
+  view_t* new_view(lua_State*, const char*, size_t, const std::shared_ptr<view_source_t>&);
 }
 
 #endif
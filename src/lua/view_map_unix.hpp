@@ -0,0 +1,112 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_VIEW_MAP_UNIX_HPP
+#define BRIGID_VIEW_MAP_UNIX_HPP
+
+#include "error.hpp"
+#include "memory.hpp"
+#include "noncopyable.hpp"
+#include "scope_exit.hpp"
+#include "view.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <memory>
+
+namespace brigid {
+  namespace {
+    static const uint64_t map_to_end = static_cast<uint64_t>(-1);
+
+    // A read-only mapping of a range of a file. The file is closed after
+    // mapping, and the range is unmapped by the destructor. If the file is
+    // truncated while it is mapped, reading the pages beyond the new end
+    // raises SIGBUS.
+    class mapped_file_t : public view_source_t, private noncopyable {
+    public:
+      mapped_file_t(const char* path, uint64_t offset, uint64_t size, const std::shared_ptr<memory_usage_t>& memory_usage)
+        : map_(),
+          map_size_(),
+          data_(""),
+          size_(),
+          memory_usage_(memory_usage) {
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) {
+          throw BRIGID_SYSTEM_ERROR();
+        }
+        scope_exit scope_guard([&]() {
+          ::close(fd);
+        });
+
+        struct stat status = {};
+        if (fstat(fd, &status) == -1) {
+          throw BRIGID_SYSTEM_ERROR();
+        }
+        uint64_t file_size = status.st_size;
+        if (offset > file_size) {
+          throw BRIGID_RUNTIME_ERROR("offset out of range");
+        }
+        if (size == map_to_end) {
+          size = file_size - offset;
+        } else if (size > file_size - offset) {
+          throw BRIGID_RUNTIME_ERROR("size out of range");
+        }
+        if (size == 0) {
+          return;
+        }
+
+        // The offset of mmap must be a multiple of the page size.
+        uint64_t page_size = sysconf(_SC_PAGESIZE);
+        uint64_t base = offset - offset % page_size;
+        if (size > SIZE_MAX - (offset - base)) {
+          throw BRIGID_RUNTIME_ERROR("size too large");
+        }
+        size_t map_size = size + (offset - base);
+        void* map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(base));
+        if (map == MAP_FAILED) {
+          throw BRIGID_SYSTEM_ERROR();
+        }
+#ifdef HAVE_MADVISE
+        // Ignore errors because the advice is only a hint.
+        madvise(map, map_size, MADV_SEQUENTIAL);
+        madvise(map, map_size, MADV_WILLNEED);
+#endif
+        map_ = map;
+        map_size_ = map_size;
+        data_ = static_cast<const char*>(map) + (offset - base);
+        size_ = size;
+        memory_usage_->increase(memory_view, map_size_);
+      }
+
+      ~mapped_file_t() {
+        if (map_) {
+          munmap(map_, map_size_);
+          memory_usage_->decrease(memory_view, map_size_);
+        }
+      }
+
+      const char* data() const {
+        return data_;
+      }
+
+      size_t size() const {
+        return size_;
+      }
+
+    private:
+      void* map_;
+      size_t map_size_;
+      const char* data_;
+      size_t size_;
+      std::shared_ptr<memory_usage_t> memory_usage_;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Copyright (c) 2026 <dev@brigid.jp>
+// This software is released under the MIT License.
+// https://opensource.org/licenses/mit-license.php
+
+#ifndef BRIGID_VIEW_MAP_WINDOWS_HPP
+#define BRIGID_VIEW_MAP_WINDOWS_HPP
+
+#include "common_windows.hpp"
+#include "error.hpp"
+#include "memory.hpp"
+#include "noncopyable.hpp"
+#include "view.hpp"
+
+#include <windows.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+namespace brigid {
+  namespace {
+    static const uint64_t map_to_end = static_cast<uint64_t>(-1);
+
+    [[noreturn]] void throw_windows_error() {
+      DWORD code = GetLastError();
+      std::string message;
+      if (get_error_message("kernel32.dll", code, message)) {
+        throw BRIGID_RUNTIME_ERROR(message, make_error_code("windows error", code));
+      } else {
+        throw BRIGID_RUNTIME_ERROR(make_error_code("windows error", code));
+      }
+    }
+
+    using handle_t = std::unique_ptr<void, decltype(&CloseHandle)>;
+
+    // A read-only mapping of a range of a file. The file and the mapping
+    // object are closed after mapping, and the range is unmapped by the
+    // destructor.
+    class mapped_file_t : public view_source_t, private noncopyable {
+    public:
+      mapped_file_t(const char* path, uint64_t offset, uint64_t size, const std::shared_ptr<memory_usage_t>& memory_usage)
+        : map_(),
+          map_size_(),
+          data_(""),
+          size_(),
+          memory_usage_(memory_usage) {
+        handle_t file(CreateFileW(
+            decode_utf8(path).c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr), &CloseHandle);
+        if (file.get() == INVALID_HANDLE_VALUE) {
+          file.release();
+          throw_windows_error();
+        }
+
+        LARGE_INTEGER file_size = {};
+        if (!GetFileSizeEx(file.get(), &file_size)) {
+          throw_windows_error();
+        }
+        if (offset > static_cast<uint64_t>(file_size.QuadPart)) {
+          throw BRIGID_RUNTIME_ERROR("offset out of range");
+        }
+        uint64_t rest = file_size.QuadPart - offset;
+        if (size == map_to_end) {
+          size = rest;
+        } else if (size > rest) {
+          throw BRIGID_RUNTIME_ERROR("size out of range");
+        }
+        if (size == 0) {
+          return;
+        }
+
+        handle_t mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr), &CloseHandle);
+        if (!mapping) {
+          throw_windows_error();
+        }
+
+        // The offset of MapViewOfFile must be a multiple of the allocation
+        // granularity.
+        SYSTEM_INFO info = {};
+        GetSystemInfo(&info);
+        uint64_t base = offset - offset % info.dwAllocationGranularity;
+        if (size > SIZE_MAX - (offset - base)) {
+          throw BRIGID_RUNTIME_ERROR("size too large");
+        }
+        size_t map_size = static_cast<size_t>(size + (offset - base));
+        void* map = MapViewOfFile(
+            mapping.get(),
+            FILE_MAP_READ,
+            static_cast<DWORD>(base >> 32),
+            static_cast<DWORD>(base & 0xFFFFFFFF),
+            map_size);
+        if (!map) {
+          throw_windows_error();
+        }
+        map_ = map;
+        map_size_ = map_size;
+        data_ = static_cast<const char*>(map) + (offset - base);
+        size_ = static_cast<size_t>(size);
+        memory_usage_->increase(memory_view, map_size_);
+      }
+
+      ~mapped_file_t() {
+        if (map_) {
+          UnmapViewOfFile(map_);
+          memory_usage_->decrease(memory_view, map_size_);
+        }
+      }
+
+      const char* data() const {
+        return data_;
+      }
+
+      size_t size() const {
+        return size_;
+      }
+
+    private:
+      void* map_;
+      size_t map_size_;
+      const char* data_;
+      size_t size_;
+      std::shared_ptr<memory_usage_t> memory_usage_;
+    };
+  }
+}
+
+#endif
@@ -1,10 +1,11 @@
 // vim: syntax=ragel:
 
-// Copyright (c) 2024 <dev@brigid.jp>
+// Copyright (c) 2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
 #include "error.hpp"
+#include "scan.hpp"
 #include "writer.hpp"
 
 #include <stddef.h>
@@ -58,7 +59,7 @@ namespace brigid {
 
       main :=
         ( escaped+
-        | unescaped+ >{ ps = fpc; } %{ self->write(ps, fpc - ps); }
+        | unescaped+ >{ ps = fpc; fexec scan_json_escape(fpc + 1, pe); } %{ self->write(ps, fpc - ps); }
         )**;
 
       write data noerror nofinal noentry;
@@ -1,4 +1,4 @@
-// Copyright (c) 2024 <dev@brigid.jp>
+// Copyright (c) 2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -6,94 +6,43 @@
 #include "data.hpp"
 #include "error.hpp"
 #include "function.hpp"
+#include "number.hpp"
 #include "stack_guard.hpp"
 #include "writer.hpp"
 
 #include <lua.hpp>
 
+#include <float.h>
 #include <stddef.h>
-#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <cmath>
 #include <algorithm>
 #include <vector>
 
 namespace brigid {
-  void write_json_string(writer_t*, const char* data, size_t size);
+  data_t to_json_raw(lua_State*, int);
+  void write_json_reformat(writer_t*, const char* data, size_t size, int indent);
   void write_urlencoded(writer_t*, const data_t&);
 
-  namespace {
-    writer_t* check_writer_impl(lua_State* L, int arg) {
-      if (writer_t* self = to_writer_data_writer(L, arg)) {
-        return self;
-      } else if (writer_t* self = to_writer_file_writer(L, arg)) {
-        return self;
-      }
-      luaL_argerror(L, arg, "brigid.writer expected");
-      throw BRIGID_LOGIC_ERROR("unreachable");
+  writer_t* to_writer(lua_State* L, int arg) {
+    if (writer_t* self = to_writer_data_writer(L, arg)) {
+      return self;
     }
+    return to_writer_file_writer(L, arg);
+  }
 
-    writer_t* check_writer(lua_State* L, int arg) {
-      writer_t* self = check_writer_impl(L, arg);
-      if (!self->closed()) {
-        return self;
-      }
+  writer_t* check_writer(lua_State* L, int arg) {
+    writer_t* self = to_writer(L, arg);
+    if (!self) {
+      luaL_argerror(L, arg, "brigid.writer expected");
+    } else if (self->closed()) {
       luaL_argerror(L, arg, "attempt to use a closed brigid.writer");
-      throw BRIGID_LOGIC_ERROR("unreachable");
-    }
-
-    template <class T>
-    int snprintf_wrapper(char* buffer, size_t size, const char* format, T value) {
-#ifdef _MSC_VER
-        return _snprintf_s(buffer, size, size - 1, format, value);
-#else
-        return snprintf(buffer, size, format, value);
-#endif
-    }
-
-    void write_json_number(lua_State* L, writer_t* self, int index) {
-      char buffer[64] = {};
-
-#if LUA_VERSION_NUM >= 503
-      {
-        int result = 0;
-        lua_Integer value = lua_tointegerx(L, index, &result);
-        if (result) {
-          int size = snprintf_wrapper(buffer, sizeof(buffer), LUA_INTEGER_FMT, value);
-          if (size < 0) {
-            throw BRIGID_SYSTEM_ERROR();
-          }
-          self->write(buffer, size);
-          return;
-        }
-      }
-#endif
-
-#if LUA_VERSION_NUM >= 502
-      int result = 0;
-      lua_Number value = lua_tonumberx(L, index, &result);
-#else
-      lua_Number value = lua_tonumber(L, index);
-      int result = value != 0 || lua_isnumber(L, index);
-#endif
-      if (!result) {
-        throw BRIGID_LOGIC_ERROR("number expected");
-      }
-      if (!(std::isfinite)(value)) {
-        throw BRIGID_LOGIC_ERROR("inf or nan");
-      }
-
-      if (value == 0) { // check for both zero and minus zero
-        self->write('0');
-        return;
-      }
-
-      int size = snprintf_wrapper(buffer, sizeof(buffer), "%.17g", value);
-      if (size < 0) {
-        throw BRIGID_SYSTEM_ERROR();
-      }
-      self->write(buffer, size);
     }
+    return self;
+  }
 
+  namespace {
     void write_json_indent(writer_t* self, int indent, int depth) {
       self->write('\n');
       for (int i = 0; i < indent * depth; ++i) {
@@ -124,8 +73,6 @@ namespace brigid {
 
     using json_keys_t = std::vector<json_key_t>;
 
-    void write_json(lua_State*, writer_t*, int, int, int, bool);
-
     bool write_json_array(lua_State* L, writer_t* self, int index, int indent, int depth, bool sort_keys) {
       stack_guard guard(L);
 
@@ -308,54 +255,295 @@ namespace brigid {
       }
     }
 
-    void write_json(lua_State* L, writer_t* self, int index, int indent, int depth, bool sort_keys) {
+    // Writes the tag followed by the value in size bytes.
+    void write_big_endian(writer_t* self, char tag, uint64_t value, int size) {
+      char buffer[9] = { tag };
+      for (int i = size; i > 0; --i) {
+        buffer[i] = static_cast<char>(value & 0xFF);
+        value >>= 8;
+      }
+      self->write(buffer, size + 1);
+    }
+
+    void write_msgpack_integer(writer_t* self, int64_t value) {
+      if (value >= 0) {
+        if (value < 0x80) {
+          self->write(static_cast<char>(value));
+        } else if (value <= 0xFF) {
+          write_big_endian(self, '\xCC', value, 1);
+        } else if (value <= 0xFFFF) {
+          write_big_endian(self, '\xCD', value, 2);
+        } else if (value <= 0xFFFFFFFF) {
+          write_big_endian(self, '\xCE', value, 4);
+        } else {
+          write_big_endian(self, '\xCF', value, 8);
+        }
+      } else {
+        if (value >= -32) {
+          self->write(static_cast<char>(value));
+        } else if (value >= -0x80) {
+          write_big_endian(self, '\xD0', value, 1);
+        } else if (value >= -0x8000) {
+          write_big_endian(self, '\xD1', value, 2);
+        } else if (value >= -0x7FFFFFFF - 1) {
+          write_big_endian(self, '\xD2', value, 4);
+        } else {
+          write_big_endian(self, '\xD3', value, 8);
+        }
+      }
+    }
+
+    void write_msgpack_number(lua_State* L, writer_t* self, int index) {
+#if LUA_VERSION_NUM >= 503
+      if (lua_isinteger(L, index)) {
+        write_msgpack_integer(self, lua_tointeger(L, index));
+        return;
+      }
+#endif
+      lua_Number value = lua_tonumber(L, index);
+#if LUA_VERSION_NUM < 503
+      if (std::floor(value) == value && -9223372036854775808.0 <= value && value < 9223372036854775808.0) {
+        write_msgpack_integer(self, static_cast<int64_t>(value));
+        return;
+      }
+#endif
+      double source = value;
+      uint64_t bits = 0;
+      memcpy(&bits, &source, sizeof(bits));
+      write_big_endian(self, '\xCB', bits, 8);
+    }
+
+    // The tags are fixstr or bin/str 8, 16 and 32.
+    void write_msgpack_bytes(writer_t* self, char fixtag, char tag, const char* data, size_t size) {
+      if (fixtag && size < 32) {
+        self->write(static_cast<char>(static_cast<unsigned char>(fixtag) | size));
+      } else if (size <= 0xFF) {
+        write_big_endian(self, tag, size, 1);
+      } else if (size <= 0xFFFF) {
+        write_big_endian(self, tag + 1, size, 2);
+      } else if (size <= 0xFFFFFFFF) {
+        write_big_endian(self, tag + 2, size, 4);
+      } else {
+        throw BRIGID_LOGIC_ERROR("data too long");
+      }
+      self->write(data, size);
+    }
+
+    // The tags are fixarray or fixmap and array/map 16 and 32.
+    void write_msgpack_header(writer_t* self, char fixtag, char tag, size_t size) {
+      if (size < 16) {
+        self->write(static_cast<char>(static_cast<unsigned char>(fixtag) | size));
+      } else if (size <= 0xFFFF) {
+        write_big_endian(self, tag, size, 2);
+      } else if (size <= 0xFFFFFFFF) {
+        write_big_endian(self, tag + 1, size, 4);
+      } else {
+        throw BRIGID_LOGIC_ERROR("table too large");
+      }
+    }
+
+    void write_msgpack(lua_State*, writer_t*, int);
+
+    // A table is written as an array in the same way as write_json.
+    void write_msgpack_table(lua_State* L, writer_t* self, int index) {
+      stack_guard guard(L);
+      lua_checkstack(L, 3);
+
+#if LUA_VERSION_NUM >= 502
+      size_t size = lua_rawlen(L, index);
+#else
+      size_t size = lua_objlen(L, index);
+#endif
+      bool is_array = size > 0;
+      if (!is_array && lua_getmetatable(L, index)) {
+        luaL_getmetatable(L, "brigid.json.array");
+        is_array = lua_rawequal(L, -1, -2);
+        lua_settop(L, guard.top());
+      }
+
+      if (is_array) {
+        write_msgpack_header(self, '\x90', '\xDC', size);
+        for (size_t i = 1; i <= size; ++i) {
+          lua_rawgeti(L, index, i);
+          write_msgpack(L, self, guard.top() + 1);
+          lua_pop(L, 1);
+        }
+        return;
+      }
+
+      size = 0;
+      lua_pushnil(L);
+      while (lua_next(L, index)) {
+        ++size;
+        lua_pop(L, 1);
+      }
+      write_msgpack_header(self, '\x80', '\xDE', size);
+      lua_pushnil(L);
+      while (lua_next(L, index)) {
+        write_msgpack(L, self, guard.top() + 1);
+        write_msgpack(L, self, guard.top() + 2);
+        lua_pop(L, 1);
+      }
+    }
+
+    void write_msgpack(lua_State* L, writer_t* self, int index) {
       switch (lua_type(L, index)) {
         case LUA_TNIL:
-          self->write("null", 4);
+          self->write('\xC0');
           return;
 
         case LUA_TNUMBER:
-          write_json_number(L, self, index);
+          write_msgpack_number(L, self, index);
           return;
 
         case LUA_TBOOLEAN:
-          if (lua_toboolean(L, index)) {
-            self->write("true", 4);
-          } else {
-            self->write("false", 5);
-          }
+          self->write(lua_toboolean(L, index) ? '\xC3' : '\xC2');
           return;
 
         case LUA_TSTRING:
           {
             size_t size = 0;
-            if (const char* data = lua_tolstring(L, index, &size)) {
-              write_json_string(self, data, size);
-            } else {
-              throw BRIGID_LOGIC_ERROR("string expected");
-            }
+            const char* data = lua_tolstring(L, index, &size);
+            write_msgpack_bytes(self, '\xA0', '\xD9', data, size);
           }
           return;
 
         case LUA_TTABLE:
-          write_json_table(L, self, index, indent, depth, sort_keys);
+          write_msgpack_table(L, self, index);
           return;
 
         case LUA_TLIGHTUSERDATA:
           if (!lua_touserdata(L, index)) {
-            self->write("null", 4);
+            self->write('\xC0');
             return;
           }
           break;
       }
 
       if (data_t data = to_data(L, index)) {
-        write_json_string(self, data.data(), data.size());
+        write_msgpack_bytes(self, 0, '\xC4', data.data(), data.size());
       } else {
         throw BRIGID_LOGIC_ERROR("brigid.data expected");
       }
     }
 
+    void write_cbor_head(writer_t* self, int major, uint64_t value) {
+      char tag = static_cast<char>(major << 5);
+      if (value < 24) {
+        self->write(static_cast<char>(tag | value));
+      } else if (value <= 0xFF) {
+        write_big_endian(self, tag | 24, value, 1);
+      } else if (value <= 0xFFFF) {
+        write_big_endian(self, tag | 25, value, 2);
+      } else if (value <= 0xFFFFFFFF) {
+        write_big_endian(self, tag | 26, value, 4);
+      } else {
+        write_big_endian(self, tag | 27, value, 8);
+      }
+    }
+
+    void write_cbor_integer(writer_t* self, int64_t value) {
+      if (value >= 0) {
+        write_cbor_head(self, 0, value);
+      } else {
+        write_cbor_head(self, 1, -1 - value);
+      }
+    }
+
+    // A float is written in single precision if it is exact.
+    void write_cbor_number(lua_State* L, writer_t* self, int index) {
+#if LUA_VERSION_NUM >= 503
+      if (lua_isinteger(L, index)) {
+        write_cbor_integer(self, lua_tointeger(L, index));
+        return;
+      }
+#endif
+      lua_Number value = lua_tonumber(L, index);
+#if LUA_VERSION_NUM < 503
+      if (std::floor(value) == value && -9223372036854775808.0 <= value && value < 9223372036854775808.0) {
+        write_cbor_integer(self, static_cast<int64_t>(value));
+        return;
+      }
+#endif
+      double source = value;
+      // Converting a finite value out of the range of float is undefined.
+      if (source != source || std::isinf(source) || std::fabs(source) <= FLT_MAX) {
+        float single = static_cast<float>(source);
+        if (single == source || source != source) {
+          uint32_t bits = 0;
+          memcpy(&bits, &single, sizeof(bits));
+          write_big_endian(self, '\xFA', bits, 4);
+          return;
+        }
+      }
+      uint64_t bits = 0;
+      memcpy(&bits, &source, sizeof(bits));
+      write_big_endian(self, '\xFB', bits, 8);
+    }
+
+    // A table is written as an array in the same way as write_json.
+    void write_cbor_table(lua_State* L, writer_t* self, int index) {
+      stack_guard guard(L);
+      lua_checkstack(L, 3);
+
+#if LUA_VERSION_NUM >= 502
+      size_t size = lua_rawlen(L, index);
+#else
+      size_t size = lua_objlen(L, index);
+#endif
+      bool is_array = size > 0;
+      if (!is_array && lua_getmetatable(L, index)) {
+        luaL_getmetatable(L, "brigid.json.array");
+        is_array = lua_rawequal(L, -1, -2);
+        lua_settop(L, guard.top());
+      }
+
+      if (is_array) {
+        write_cbor_head(self, 4, size);
+        for (size_t i = 1; i <= size; ++i) {
+          lua_rawgeti(L, index, i);
+          write_cbor(L, self, guard.top() + 1);
+          lua_pop(L, 1);
+        }
+        return;
+      }
+
+      size = 0;
+      lua_pushnil(L);
+      while (lua_next(L, index)) {
+        ++size;
+        lua_pop(L, 1);
+      }
+      write_cbor_head(self, 5, size);
+      lua_pushnil(L);
+      while (lua_next(L, index)) {
+        write_cbor(L, self, guard.top() + 1);
+        write_cbor(L, self, guard.top() + 2);
+        lua_pop(L, 1);
+      }
+    }
+
+    // Returns the pointer to the window and its size. The window is valid
+    // until the next write.
+    void impl_prepare(lua_State* L) {
+      writer_t* self = check_writer(L, 1);
+      size_t size = check_integer<size_t>(L, 2);
+      push_pointer(L, self->prepare(size));
+      push_integer(L, self->available());
+    }
+
+    void impl_commit(lua_State* L) {
+      writer_t* self = check_writer(L, 1);
+      size_t size = check_integer<size_t>(L, 2);
+      self->commit(size);
+    }
+
+    void impl_write_cbor(lua_State* L) {
+      writer_t* self = check_writer(L, 1);
+      luaL_checkany(L, 2);
+      write_cbor(L, self, 2);
+    }
+
     void impl_write_json_number(lua_State* L) {
       writer_t* self = check_writer(L, 1);
       write_json_number(L, self, 2);
@@ -374,6 +562,22 @@ namespace brigid {
       write_json(L, self, 2, indent, 0, sort_keys);
     }
 
+    void impl_write_json_reformat(lua_State* L) {
+      writer_t* self = check_writer(L, 1);
+      data_t data = check_data(L, 2);
+      int indent = opt_integer<int>(L, 3, 0);
+      if (indent < 0) {
+        throw BRIGID_LOGIC_ERROR("out of range");
+      }
+      write_json_reformat(self, data.data(), data.size(), indent);
+    }
+
+    void impl_write_msgpack(lua_State* L) {
+      writer_t* self = check_writer(L, 1);
+      luaL_checkany(L, 2);
+      write_msgpack(L, self, 2);
+    }
+
     void impl_write_urlencoded(lua_State* L) {
       writer_t* self = check_writer(L, 1);
       data_t data = check_data(L, 2);
@@ -381,12 +585,166 @@ namespace brigid {
     }
   }
 
+  void write_cbor(lua_State* L, writer_t* self, int index) {
+    switch (lua_type(L, index)) {
+      case LUA_TNIL:
+        self->write('\xF6');
+        return;
+
+      case LUA_TNUMBER:
+        write_cbor_number(L, self, index);
+        return;
+
+      case LUA_TBOOLEAN:
+        self->write(lua_toboolean(L, index) ? '\xF5' : '\xF4');
+        return;
+
+      case LUA_TSTRING:
+        {
+          size_t size = 0;
+          const char* data = lua_tolstring(L, index, &size);
+          write_cbor_head(self, 3, size);
+          self->write(data, size);
+        }
+        return;
+
+      case LUA_TTABLE:
+        write_cbor_table(L, self, index);
+        return;
+
+      case LUA_TLIGHTUSERDATA:
+        if (!lua_touserdata(L, index)) {
+          self->write('\xF6');
+          return;
+        }
+        break;
+    }
+
+    if (data_t data = to_data(L, index)) {
+      write_cbor_head(self, 2, data.size());
+      self->write(data.data(), data.size());
+    } else {
+      throw BRIGID_LOGIC_ERROR("brigid.data expected");
+    }
+  }
+
+  void write_cbor_break(writer_t* self) {
+    self->write('\xFF');
+  }
+
+  void write_cbor_indefinite(writer_t* self, int major) {
+    self->write(static_cast<char>(major << 5 | 31));
+  }
+
+  void write_json_number(lua_State* L, writer_t* self, int index) {
+    char buffer[32] = {};
+
+#if LUA_VERSION_NUM >= 503
+    {
+      int result = 0;
+      lua_Integer value = lua_tointegerx(L, index, &result);
+      if (result) {
+        self->write(buffer, format_integer(value, buffer) - buffer);
+        return;
+      }
+    }
+#endif
+
+#if LUA_VERSION_NUM >= 502
+    int result = 0;
+    lua_Number value = lua_tonumberx(L, index, &result);
+#else
+    lua_Number value = lua_tonumber(L, index);
+    int result = value != 0 || lua_isnumber(L, index);
+#endif
+    if (!result) {
+      throw BRIGID_LOGIC_ERROR("number expected");
+    }
+    if (!(std::isfinite)(value)) {
+      throw BRIGID_LOGIC_ERROR("inf or nan");
+    }
+
+    if (value == 0) { // check for both zero and minus zero
+      self->write('0');
+      return;
+    }
+
+    self->write(buffer, format_double(value, buffer) - buffer);
+  }
+
+  void write_json(lua_State* L, writer_t* self, int index, int indent, int depth, bool sort_keys) {
+    switch (lua_type(L, index)) {
+      case LUA_TNIL:
+        self->write("null", 4);
+        return;
+
+      case LUA_TNUMBER:
+        write_json_number(L, self, index);
+        return;
+
+      case LUA_TBOOLEAN:
+        if (lua_toboolean(L, index)) {
+          self->write("true", 4);
+        } else {
+          self->write("false", 5);
+        }
+        return;
+
+      case LUA_TSTRING:
+        {
+          size_t size = 0;
+          if (const char* data = lua_tolstring(L, index, &size)) {
+            write_json_string(self, data, size);
+          } else {
+            throw BRIGID_LOGIC_ERROR("string expected");
+          }
+        }
+        return;
+
+      case LUA_TTABLE:
+        write_json_table(L, self, index, indent, depth, sort_keys);
+        return;
+
+      case LUA_TLIGHTUSERDATA:
+        if (!lua_touserdata(L, index)) {
+          self->write("null", 4);
+          return;
+        }
+        break;
+
+      case LUA_TUSERDATA:
+        if (data_t data = to_json_raw(L, index)) {
+          self->write(data.data(), data.size());
+          return;
+        }
+        break;
+    }
+
+    if (data_t data = to_data(L, index)) {
+      write_json_string(self, data.data(), data.size());
+    } else {
+      throw BRIGID_LOGIC_ERROR("brigid.data expected");
+    }
+  }
+
+  writer_t::writer_t()
+    : cursor_(),
+      limit_(),
+      prepared_(),
+      window_(),
+      window_size_() {}
+
   writer_t::~writer_t() {}
 
   void initialize_writer(lua_State* L) {
-    decltype(function<impl_write_json_number>())::set_field(L, -1, "write_json_number");
-    decltype(function<impl_write_json_string>())::set_field(L, -1, "write_json_string");
-    decltype(function<impl_write_json>())::set_field(L, -1, "write_json");
-    decltype(function<impl_write_urlencoded>())::set_field(L, -1, "write_urlencoded");
+    decltype(memory_function<impl_prepare>())::set_field(L, -1, "prepare");
+    decltype(function<impl_commit>())::set_field(L, -1, "commit");
+    decltype(memory_function<impl_write_cbor>())::set_field(L, -1, "write_cbor");
+    decltype(memory_function<impl_write_json_number>())::set_field(L, -1, "write_json_number");
+    decltype(memory_function<impl_write_json_string>())::set_field(L, -1, "write_json_string");
+    decltype(memory_function<impl_write_json>())::set_field(L, -1, "write_json");
+    decltype(memory_function<impl_write_json_reformat>())::set_field(L, -1, "write_json_reformat");
+    decltype(memory_function<impl_write_msgpack>())::set_field(L, -1, "write_msgpack");
+    decltype(memory_function<impl_write_urlencoded>())::set_field(L, -1, "write_urlencoded");
   }
 }
@@ -1,4 +1,4 @@
-// Copyright (c) 2024 <dev@brigid.jp>
+// Copyright (c) 2024,2026 <dev@brigid.jp>
 // This software is released under the MIT License.
 // https://opensource.org/licenses/mit-license.php
 
@@ -6,22 +6,101 @@
 #define BRIGID_WRITER_HPP
 
 #include "common.hpp"
+#include "error.hpp"
 
 #include <lua.hpp>
 
 #include <stddef.h>
+#include <string.h>
 
 namespace brigid {
+  // Emitters write into the window [cursor_, limit_) without virtual calls.
+  // refill is called only if the window cannot hold the data.
   class writer_t {
   public:
+    writer_t();
     virtual ~writer_t() = 0;
     virtual bool closed() const = 0;
-    virtual void write(const char*, size_t) = 0;
-    virtual void write(char) = 0;
+
+    void write(const char* data, size_t size) {
+      if (size <= static_cast<size_t>(limit_ - cursor_)) {
+        if (size > 0) {
+          memcpy(cursor_, data, size);
+          cursor_ += size;
+        }
+      } else {
+        refill(data, size);
+      }
+    }
+
+    void write(char c) {
+      if (cursor_ != limit_) {
+        *cursor_++ = c;
+      } else {
+        refill(&c, 1);
+      }
+    }
+
+    // Returns the window of at least size bytes at the tail. A producer
+    // fills it in place and appends the bytes by commit, so the data is not
+    // copied through an intermediate buffer. The window is valid until the
+    // next write or commit.
+    char* prepare(size_t size) {
+      if (size > static_cast<size_t>(limit_ - cursor_)) {
+        expand(size);
+      }
+      prepared_ = true;
+      window_ = cursor_;
+      window_size_ = limit_ - cursor_;
+      return cursor_;
+    }
+
+    void commit(size_t size) {
+      if (!prepared_ || window_ != cursor_) {
+        throw BRIGID_LOGIC_ERROR("no prepared window");
+      }
+      if (size > window_size_) {
+        throw BRIGID_LOGIC_ERROR("out of range");
+      }
+      cursor_ += size;
+      prepared_ = false;
+    }
+
+    size_t available() const {
+      return limit_ - cursor_;
+    }
+
+  protected:
+    char* cursor_;
+    char* limit_;
+
+    // Writes the data which does not fit in the window and renews the
+    // window.
+    virtual void refill(const char*, size_t) = 0;
+
+    // Renews the window to hold at least size bytes without writing.
+    virtual void expand(size_t) = 0;
+
+  private:
+    // The window returned by prepare. A write moves the cursor and
+    // invalidates it.
+    bool prepared_;
+    char* window_;
+    size_t window_size_;
   };
 
   writer_t* to_writer_data_writer(lua_State*, int);
   writer_t* to_writer_file_writer(lua_State*, int);
+  writer_t* to_writer(lua_State*, int);
+  writer_t* check_writer(lua_State*, int);
+  // Pushes a new brigid.data_writer.
+  writer_t* new_data_writer(lua_State*);
+  void write_cbor(lua_State*, writer_t*, int);
+  void write_cbor_break(writer_t*);
+  void write_cbor_indefinite(writer_t*, int);
+  void write_json(lua_State*, writer_t*, int, int, int, bool);
+  void write_json_number(lua_State*, writer_t*, int);
+  void write_json_string(writer_t*, const char*, size_t);
   void initialize_writer(lua_State*);
 }
 
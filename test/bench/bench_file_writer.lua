@@ -0,0 +1,35 @@
+-- Copyright (c) 2026 <dev@brigid.jp>
+-- This software is released under the MIT License.
+-- https://opensource.org/licenses/mit-license.php
+
+local brigid = require "brigid"
+
+local path = arg[1] or "bench_file_writer.dat"
+local n = tonumber(arg[2]) or 100000
+
+local source = {}
+for i = 1, n do
+  source[i] = { id = i, name = "item" .. i, values = { i, i * 0.5, i * 0.25 } }
+end
+
+local t = brigid.stopwatch()
+
+local function bench(name, options)
+  t:start()
+  local file_writer = assert(brigid.file_writer(path, options))
+  file_writer:write_json(source, 2)
+  assert(file_writer:close())
+  t:stop()
+  print(("%-32s %10.3f ms"):format(name, t:get_elapsed() * 0.000001))
+end
+
+-- buffer_size = 0 passes each piece to fwrite and uses the buffering of
+-- stdio. It is not the fputc path which file_writer used before writer_t had
+-- a window, because the pieces are no longer split into characters.
+bench("buffer_size = 0 (stdio)", { buffer_size = 0 })
+bench("buffer_size = 4096", { buffer_size = 4096 })
+bench("buffer_size = 65536", {})
+bench("buffer_size = 1048576", { buffer_size = 1048576 })
+bench("buffer_size = 65536, hints", { preallocate = 64 * n, sequential = true })
+
+os.remove(path)
@@ -0,0 +1,63 @@
+-- Copyright (c) 2026 <dev@brigid.jp>
+-- This software is released under the MIT License.
+-- https://opensource.org/licenses/mit-license.php
+
+local brigid = require "brigid"
+
+local n = tonumber(arg[1]) or 100000
+local m = tonumber(arg[2]) or 10
+
+local records = {}
+for i = 1, n do
+  records[i] = {
+    id = i;
+    name = "record" .. i;
+    score = math.random() * 1000;
+    active = i % 2 == 0;
+    pos = { x = i, y = -i };
+  }
+end
+
+local schema = brigid.json.compile {
+  { "id", "number" };
+  { "name", "string" };
+  { "score", "number" };
+  { "active", "boolean" };
+  { "pos", { { "x", "number" }, { "y", "number" } } };
+}
+
+local t = brigid.stopwatch()
+
+local function bench(name, f)
+  local result
+  t:start()
+  for _ = 1, m do
+    result = f()
+  end
+  t:stop()
+  print(("%-24s %10.3f ms %10d bytes"):format(name, t:get_elapsed() / m * 0.000001, result:get_size()))
+end
+
+bench("write_json", function ()
+  local data_writer = brigid.data_writer()
+  for i = 1, n do
+    data_writer:write_json(records[i])
+  end
+  return data_writer
+end)
+
+bench("write_json sort_keys", function ()
+  local data_writer = brigid.data_writer()
+  for i = 1, n do
+    data_writer:write_json(records[i], 0, true)
+  end
+  return data_writer
+end)
+
+bench("json.compile", function ()
+  local data_writer = brigid.data_writer()
+  for i = 1, n do
+    schema:write(data_writer, records[i])
+  end
+  return data_writer
+end)
@@ -0,0 +1,52 @@
+-- Copyright (c) 2026 <dev@brigid.jp>
+-- This software is released under the MIT License.
+-- https://opensource.org/licenses/mit-license.php
+
+local brigid = require "brigid"
+
+local n = tonumber(arg[1]) or 100000
+local m = tonumber(arg[2]) or 4
+
+local data_writer = brigid.data_writer()
+for i = 1, n do
+  data_writer:write_json {
+    id = i;
+    name = "record" .. i;
+    score = math.random() * 1000;
+    tags = { "foo", "bar", "baz" };
+    nested = { a = i, b = { c = true, d = false } };
+  }
+  data_writer:write "\n"
+end
+
+local t = brigid.stopwatch()
+
+local function bench(name, f)
+  local count
+  t:start()
+  for _ = 1, m do
+    count = f()
+  end
+  t:stop()
+  assert(count == n)
+  print(("%-24s %10.3f ms %10d bytes"):format(name, t:get_elapsed() / m * 0.000001, data_writer:get_size()))
+end
+
+bench("gmatch json.parse", function ()
+  local count = 0
+  for line in data_writer:get_string():gmatch "[^\n]+" do
+    brigid.json.parse(line)
+    count = count + 1
+  end
+  return count
+end)
+
+for _, threads in ipairs { 1, 2, 4, 8 } do
+  bench("json.lines threads=" .. threads, function ()
+    local count = 0
+    for i in brigid.json.lines(data_writer, nil, { threads = threads }) do
+      count = i
+    end
+    return count
+  end)
+end
@@ -0,0 +1,54 @@
+-- Copyright (c) 2026 <dev@brigid.jp>
+-- This software is released under the MIT License.
+-- https://opensource.org/licenses/mit-license.php
+
+local brigid = require "brigid"
+
+local n = tonumber(arg[1]) or 100000
+local m = tonumber(arg[2]) or 10
+
+local floats = {}
+local integers = {}
+for i = 1, n do
+  floats[i] = math.random() * 1000
+  integers[i] = math.floor(math.random() * 1000000000)
+end
+
+local t = brigid.stopwatch()
+
+local function bench(name, f)
+  local result
+  t:start()
+  for _ = 1, m do
+    result = f()
+  end
+  t:stop()
+  print(("%-24s %10.3f ms %10d bytes"):format(name, t:get_elapsed() / m * 0.000001, #result))
+end
+
+-- The formatting which write_json_number used before.
+bench("%.17g floats", function ()
+  local buffer = {}
+  for i = 1, n do
+    buffer[i] = ("%.17g"):format(floats[i])
+  end
+  return "[" .. table.concat(buffer, ",") .. "]"
+end)
+
+bench("write_json floats", function ()
+  return brigid.data_writer():write_json(floats):get_string()
+end)
+
+bench("write_json integers", function ()
+  return brigid.data_writer():write_json(integers):get_string()
+end)
+
+local source = brigid.data_writer():write_json(floats):get_string()
+bench("json.parse floats", function ()
+  brigid.json.parse(source)
+  return source
+end)
+
+for i = 1, n do
+  assert(brigid.json.parse(brigid.data_writer():write_json_number(floats[i]):get_string()) == floats[i])
+end
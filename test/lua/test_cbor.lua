@@ -0,0 +1,110 @@
+-- Copyright (c) 2026 <dev@brigid.jp>
+-- This software is released under the MIT License.
+-- https://opensource.org/licenses/mit-license.php
+
+local brigid = require "brigid"
+local test_suite = require "test_suite"
+
+local suite = test_suite "test_cbor"
+local debug = test_debug()
+
+local function equal(self, that)
+  if self == that then
+    return true
+  end
+  if type(self) == "table" and type(that) == "table" then
+    for k, v in pairs(self) do
+      if not equal(v, that[k]) then
+        return false
+      end
+    end
+    for k, v in pairs(that) do
+      if self[k] == nil then
+        return false
+      end
+    end
+    return true
+  end
+end
+
+local function encode(value)
+  return brigid.data_writer():write_cbor(value):get_string()
+end
+
+local function hex(source)
+  return (source:gsub(".", function (c) return ("%02x"):format(c:byte()) end))
+end
+
+local function unhex(source)
+  return (source:gsub("..", function (x) return string.char(tonumber(x, 16)) end))
+end
+
+function suite:test_cbor_write()
+  assert(hex(encode(0)) == "00")
+  assert(hex(encode(24)) == "1818")
+  assert(hex(encode(1000)) == "1903e8")
+  assert(hex(encode(-100)) == "3863")
+  assert(hex(encode(1.5)) == "fa3fc00000")
+  assert(hex(encode(1.1)) == "fb3ff199999999999a")
+  assert(hex(encode(1e300)) == "fb7e37e43c8800759c")
+  assert(hex(encode(-3.5e38)) == "fbc7f074f8c4d3cd7b")
+  assert(hex(encode(math.huge)) == "fa7f800000")
+  assert(hex(encode(-math.huge)) == "faff800000")
+  assert(hex(encode(nil)) == "f6")
+  assert(hex(encode(brigid.null)) == "f6")
+  assert(hex(encode(true)) == "f5")
+  assert(hex(encode "a") == "6161")
+  assert(hex(encode(brigid.data_writer():write "ab")) == "426162")
+  assert(hex(encode { 1, 2 }) == "820102")
+  assert(hex(encode {}) == "a0")
+  assert(hex(encode(brigid.json.array())) == "80")
+end
+
+function suite:test_cbor_parse()
+  -- RFC 8949 Appendix A
+  assert(brigid.cbor.parse(unhex "1b000000e8d4a51000") == 1000000000000)
+  assert(brigid.cbor.parse(unhex "3863") == -100)
+  assert(brigid.cbor.parse(unhex "f97bff") == 65504)
+  assert(brigid.cbor.parse(unhex "f9c400") == -4)
+  assert(brigid.cbor.parse(unhex "fb3ff199999999999a") == 1.1)
+  assert(brigid.cbor.parse(unhex "f7") == nil)
+  assert(brigid.cbor.parse(unhex "c11a514b67b0") == 1363896240)
+  assert(hex(brigid.cbor.parse(unhex "5f42010243030405ff")) == "0102030405")
+  assert(brigid.cbor.parse(unhex "7f657374726561646d696e67ff") == "streaming")
+  assert(equal(brigid.cbor.parse(unhex "9f018202039f0405ffff"), { 1, { 2, 3 }, { 4, 5 } }))
+  assert(equal(brigid.cbor.parse(unhex "bf61610161629f0203ffff"), { a = 1, b = { 2, 3 } }))
+
+  local source = { id = 42, name = "foo", tags = { "a", brigid.null }, empty = brigid.json.array(), [1.5] = false }
+  local result = brigid.cbor.parse(encode(source), brigid.null)
+  assert(equal(result, source))
+  assert(getmetatable(result.empty) == getmetatable(brigid.json.array()))
+
+  local view = brigid.cbor.parse(unhex "450102030405", nil, { view_threshold = 4 })
+  assert(type(view) == "userdata")
+  assert(hex(view:get_string()) == "0102030405")
+
+  local result, message = pcall(brigid.cbor.parse, brigid.data_writer():write(unhex "450102030405"), nil, { view_threshold = 4 })
+  if debug then print(message) end
+  assert(not result)
+end
+
+function suite:test_cbor_parse_error()
+  for _, source in ipairs { "", "ff", "1c", "8201", "9f01", "a1f601", "5f6161ff", "0102" } do
+    local result, message = brigid.cbor.parse(unhex(source))
+    if debug then print(message) end
+    assert(not result)
+    assert(message:find "cannot parse cbor")
+  end
+end
+
+function suite:test_cbor_encoder()
+  local data_writer = brigid.data_writer()
+  local encoder = brigid.cbor.encoder(data_writer)
+  encoder:begin_array():value(1):begin_object():key "a":value(true)
+  assert(not pcall(encoder.value, encoder, 1))
+  encoder:end_object():end_array()
+  assert(hex(data_writer:get_string()) == "9f01bf6161f5ffff")
+  assert(equal(brigid.cbor.parse(data_writer), { 1, { a = true } }))
+end
+
+return suite
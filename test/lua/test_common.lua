@@ -192,6 +192,36 @@ function suite:test_dir2()
   assert(m == n)
 end
 
+function suite:test_memory_stats()
+  local stats1 = brigid.memory_stats()
+  local data_writer = brigid.data_writer()
+  data_writer:write(("x"):rep(10000))
+  local stats2 = brigid.memory_stats()
+  if debug then print(stats1.data_writer, stats2.data_writer, stats2.total) end
+  assert(stats2.data_writer >= stats1.data_writer + 10000)
+  assert(stats2.total >= stats2.data_writer)
+  assert(data_writer:close())
+  assert(brigid.memory_stats().data_writer == stats1.data_writer)
+end
+
+function suite:test_memory_stats2()
+  -- The dropped writers must be collected by the steps reported for the
+  -- native memory alone, while the automatic collection is stopped.
+  collectgarbage "collect"
+  collectgarbage "stop"
+  local stats1 = brigid.memory_stats()
+  local data = ("x"):rep(2 * 1024 * 1024)
+  local peak = 0
+  for i = 1, 64 do
+    local data_writer = brigid.data_writer()
+    data_writer:write(data)
+    peak = math.max(peak, brigid.memory_stats().data_writer - stats1.data_writer)
+  end
+  collectgarbage "restart"
+  if debug then print(peak) end
+  assert(peak < 32 * 1024 * 1024)
+end
+
 function suite:test_dir3()
   local path = test_cwd.."/no such directory"
   local result, message = brigid.opendir(path)
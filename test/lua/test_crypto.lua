@@ -78,6 +78,20 @@ function suite:test_cryptor()
   assert(not result)
 end
 
+function suite:test_cryptor_data_writer()
+  local encrypted = brigid.data_writer { segment_size = 16 }
+  local cryptor = assert(brigid.encryptor(cipher, key, iv, encrypted))
+  for i = 1, #plaintext, 7 do
+    assert(cryptor:update(plaintext:sub(i, i + 6), i + 6 >= #plaintext))
+  end
+  assert(encrypted:get_string() == ciphertext)
+
+  local decrypted = brigid.data_writer()
+  local cryptor = assert(brigid.decryptor(cipher, key, iv, decrypted))
+  assert(cryptor:update(encrypted, true))
+  assert(decrypted:get_string() == plaintext)
+end
+
 for i = 1, #ciphers do
   local cipher = ciphers[i]
   local key = keys[cipher]
@@ -1,4 +1,4 @@
--- Copyright (c) 2021,2024 <dev@brigid.jp>
+-- Copyright (c) 2021,2024,2026 <dev@brigid.jp>
 -- This software is released under the MIT License.
 -- https://opensource.org/licenses/mit-license.php
 
@@ -167,6 +167,26 @@ function suite:test_write_json_string3()
   assert(result == [[""]])
 end
 
+function suite:test_write_json_string4()
+  local escapes = {
+    ["\0"] = [[\u0000]];
+    ["\31"] = [[\u001F]];
+    ["\""] = [[\"]];
+    ["\\"] = [[\\]];
+    ["\127"] = [[\u007F]];
+  }
+  for n = 1, 100 do
+    for char, escape in pairs(escapes) do
+      for i = 1, n do
+        local source = ("x"):rep(i - 1) .. char .. ("\128"):rep(n - i)
+        local expect = '"' .. ("x"):rep(i - 1) .. escape .. ("\128"):rep(n - i) .. '"'
+        local result = brigid.data_writer():write_json_string(source):get_string()
+        assert(result == expect)
+      end
+    end
+  end
+end
+
 function suite:test_write_json_number1()
   local data_writer = brigid.data_writer()
 
@@ -238,6 +258,166 @@ function suite:test_write_json_number3()
   assert(result == "1e+19,-1e+19,")
 end
 
+function suite:test_write_json_number4()
+  local data_writer = brigid.data_writer()
+  local source = { 0.1, 0.3, 1 / 3, 1e-5, 0.000125, 1e100, 5e-324, 1.7976931348623157e308, 123456.789 }
+  for i = 1, #source do
+    assert(data_writer:write_json_number(source[i])):write ","
+  end
+  local result = data_writer:get_string()
+  if debug then print(result) end
+  assert(result == "0.1,0.3,0.3333333333333333,1e-05,0.000125,1e+100,5e-324,1.7976931348623157e+308,123456.789,")
+end
+
+function suite:test_write_json_number5()
+  for i = 1, 1000 do
+    local v = (math.random() - 0.5) * 10 ^ math.random(-300, 300)
+    local result = brigid.data_writer():write_json_number(v):get_string()
+    assert(tonumber(result) == v)
+    assert(brigid.json.parse(result) == v)
+  end
+end
+
+function suite:test_data_writer_segmented()
+  local ffi
+  pcall(function () ffi = require "ffi" end)
+
+  local data_writer = assert(brigid.data_writer { segment_size = 7 })
+  local expect = {}
+  for i = 1, 20 do
+    local piece = ("%d:"):format(i):rep(i % 5)
+    data_writer:write(piece)
+    expect[#expect + 1] = piece
+  end
+  data_writer:write_json { 1, 2 }
+  expect[#expect + 1] = "[1,2]"
+  expect = table.concat(expect)
+
+  assert(data_writer:get_size() == #expect)
+  assert(data_writer:get_string() == expect)
+  assert(brigid.data_writer():write(data_writer):get_string() == expect)
+  assert(brigid.hasher "sha256":update(data_writer):digest() == brigid.hasher "sha256":update(expect):digest())
+
+  data_writer:write(data_writer)
+  expect = expect .. expect
+  assert(data_writer:get_string() == expect)
+
+  -- get_pointer joins the segments.
+  local p = assert(data_writer:get_pointer())
+  if ffi then
+    assert(ffi.string(p, #data_writer) == expect)
+  end
+  data_writer:write "foo"
+  assert(data_writer:get_string() == expect .. "foo")
+end
+
+function suite:test_data_writer_pool()
+  local pool = assert(brigid.buffer_pool { max_size = 65536 })
+  for _, segment_size in ipairs { 0, 16 } do
+    for i = 1, 4 do
+      local data_writer = assert(brigid.data_writer { segment_size = segment_size, pool = pool })
+      for j = 1, 100 do
+        data_writer:write(("%d:"):format(j))
+      end
+      assert(data_writer:get_string():find "^1:2:3:.*:99:100:$")
+      assert(data_writer:close())
+    end
+  end
+
+  local stats = pool:get_stats()
+  if debug then print(stats.hits, stats.misses, stats.retained_size) end
+  assert(stats.hits > 0)
+  assert(stats.misses > 0)
+  assert(stats.retained_size > 0)
+  assert(stats.retained_size <= 65536)
+
+  -- Steady-state writers are served from the pool.
+  local data_writer = assert(brigid.data_writer { pool = pool })
+  for j = 1, 100 do
+    data_writer:write(("%d:"):format(j))
+  end
+  assert(pool:get_stats().misses == stats.misses)
+  assert(data_writer:close())
+
+  assert(pool:clear())
+  assert(pool:get_stats().retained_size == 0)
+end
+
+function suite:test_data_writer_consume()
+  for _, segment_size in ipairs { 0, 4 } do
+    local data_writer = assert(brigid.data_writer { segment_size = segment_size })
+    data_writer:write "foo\nbar\nbaz"
+    local lines = {}
+    while true do
+      local view = data_writer:peek()
+      local s = view:get_string()
+      local i = s:find "\n"
+      if not i then
+        break
+      end
+      lines[#lines + 1] = s:sub(1, i - 1)
+      assert(data_writer:consume(i))
+      local result, message = pcall(function () view:get_string() end)
+      if debug then print(message) end
+      assert(not result)
+    end
+    assert(#lines == 2)
+    assert(lines[1] == "foo")
+    assert(lines[2] == "bar")
+    assert(data_writer:get_string() == "baz")
+
+    data_writer:write "qux"
+    assert(data_writer:get_size() == 6)
+    assert(data_writer:peek():get_string() == "bazqux")
+    assert(data_writer:consume(6))
+    assert(data_writer:get_string() == "")
+    assert(data_writer:peek():get_size() == 0)
+
+    local result, message = pcall(function () data_writer:consume(1) end)
+    if debug then print(message) end
+    assert(not result)
+  end
+end
+
+function suite:test_data_writer_prepare()
+  local ffi
+  pcall(function () ffi = require "ffi" end)
+
+  for _, segment_size in ipairs { 0, 4 } do
+    local data_writer = assert(brigid.data_writer { segment_size = segment_size })
+    data_writer:write "foo"
+    local p, n = data_writer:prepare(8)
+    assert(p)
+    assert(n >= 8)
+    if ffi then
+      ffi.copy(ffi.cast("char*", p), "barbazqux", 6)
+      assert(data_writer:commit(6))
+      assert(data_writer:write "qux")
+      assert(data_writer:get_string() == "foobarbazqux")
+      p, n = data_writer:prepare(8)
+    end
+
+    local result, message = pcall(function () data_writer:commit(n + 1) end)
+    if debug then print(message) end
+    assert(not result)
+    assert(data_writer:commit(0))
+
+    local result, message = pcall(function () data_writer:commit(0) end)
+    if debug then print(message) end
+    assert(not result)
+
+    data_writer:prepare(8)
+    data_writer:write "x"
+    assert(not pcall(function () data_writer:commit(1) end))
+  end
+
+  local data_writer = brigid.data_writer()
+  local result, message = pcall(function () data_writer:commit(8) end)
+  if debug then print(message) end
+  assert(not result)
+  assert(data_writer:get_size() == 0)
+end
+
 function suite:test_write_json1()
   local source = {
     a = {
@@ -1,4 +1,4 @@
--- Copyright (c) 2021,2024 <dev@brigid.jp>
+-- Copyright (c) 2021,2024,2026 <dev@brigid.jp>
 -- This software is released under the MIT License.
 -- https://opensource.org/licenses/mit-license.php
 
@@ -59,6 +59,59 @@ function suite:test_file_writer3()
   os.remove(path)
 end
 
+function suite:test_file_writer4()
+  local path = test_cwd .. "/test.dat"
+
+  local source = {}
+  for i = 1, 1000 do
+    source[i] = { i, ("x"):rep(i % 100), i * 0.5 }
+  end
+  local expect = brigid.data_writer():write_json(source, 2):get_string()
+
+  for _, buffer_size in ipairs { 0, 1, 16, 4096, 65536 } do
+    local file_writer = assert(brigid.file_writer(path, {
+      buffer_size = buffer_size;
+      preallocate = #expect;
+      sequential = true;
+    }))
+    assert(file_writer:write_json(source, 2))
+    assert(file_writer:close())
+
+    local handle = assert(io.open(path, "rb"))
+    local result = handle:read "*a"
+    handle:close()
+    if debug then print(buffer_size, #result) end
+    assert(result == expect)
+  end
+
+  os.remove(path)
+end
+
+function suite:test_file_writer_prepare()
+  local path = test_cwd .. "/test.dat"
+
+  -- With buffer_size = 0, the prepared window is passed to stdio in order
+  -- with the other writes.
+  for _, buffer_size in ipairs { 0, 4 } do
+    local file_writer = assert(brigid.file_writer(path, { buffer_size = buffer_size }))
+    file_writer:write "foo"
+    assert(file_writer:prepare(8))
+    assert(file_writer:commit(0))
+    file_writer:write "bar"
+    file_writer:write_json(0.5)
+    assert(file_writer:flush())
+
+    local handle = assert(io.open(path, "rb"))
+    local result = handle:read "*a"
+    handle:close()
+    if debug then print(buffer_size, result) end
+    assert(result == "foobar0.5")
+    assert(file_writer:close())
+  end
+
+  os.remove(path)
+end
+
 function suite:test_file_writer_write_urlencoded()
   local expect = "%E3%82%AD%E3%83%BC1=%E5%80%A41&%E3%82%AD%E3%83%BC2=%E5%80%A42&%E3%82%AD%E3%83%BC3=%E5%80%A43"
 
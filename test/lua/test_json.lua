@@ -1,4 +1,4 @@
--- Copyright (c) 2021,2024 <dev@brigid.jp>
+-- Copyright (c) 2021,2024,2026 <dev@brigid.jp>
 -- This software is released under the MIT License.
 -- https://opensource.org/licenses/mit-license.php
 
@@ -160,6 +160,24 @@ function suite:test_json_parse_number5()
   assert(equal(brigid.json.parse "-0.25e-0", -0.25))
 end
 
+function suite:test_json_parse_number6()
+  local source = {
+    "0.1", "0.3", "1e23", "8.589973e9", "7.038531e-26",
+    "9007199254740993", "9007199254740992.5", "123456789012345678e-5",
+    "2.2250738585072011e-308", "2.2250738585072012e-308",
+    "4.9406564584124654e-324", "2.4703282292062328e-324",
+    "1.7976931348623157e308", "1.7976931348623158e308",
+    "0.1234567890123456789", "12345678901234567890.5",
+    "1e400", "-1e400", "1e-400",
+  }
+  for i = 1, #source do
+    local s = source[i]
+    local v = brigid.json.parse(s)
+    if debug then print(s, ("%.17g"):format(v)) end
+    assert(v == tonumber(s))
+  end
+end
+
 function suite:test_json_parse_string1()
   assert(equal(brigid.json.parse [["foo"]], "foo"))
 end
@@ -195,6 +213,84 @@ function suite:test_json_parse_string6()
   assert(equal(brigid.json.parse [["\nfoo\nbar\nbaz\n"]], "\nfoo\nbar\nbaz\n"))
 end
 
+function suite:test_json_parse_string7()
+  local escapes = {
+    ["\""] = [[\"]];
+    ["\\"] = [[\\]];
+    ["\n"] = [[\n]];
+    ["\0"] = [[\u0000]];
+  }
+  for n = 1, 130 do
+    for char, escape in pairs(escapes) do
+      for i = 1, n do
+        local s = ("x"):rep(i - 1) .. char .. ("y"):rep(n - i)
+        local t = ("x"):rep(i - 1) .. escape .. ("y"):rep(n - i)
+        assert(brigid.json.parse('"' .. t .. '"') == s)
+        assert(brigid.json.parse('["' .. t .. '","' .. t .. '"]')[2] == s)
+        assert(brigid.json.parse(brigid.data_writer():write_json_string(s):get_string()) == s)
+      end
+    end
+  end
+end
+
+function suite:test_json_parse_string8()
+  -- json.parse and write_json_string scan the whole string with the SIMD
+  -- scanners. The parser fed one byte at a time and write_json_string called
+  -- for each byte see too few bytes for them, and run the scalar paths. Build
+  -- with --disable-simd (BRIGID_NO_SIMD) to run the scalar paths only.
+  local function parse_bytes(source)
+    local result = {}
+    local parser = brigid.json.parser(function (value)
+      result[#result + 1] = value
+    end)
+    for i = 1, #source do
+      assert(parser:update(source:sub(i, i)))
+    end
+    assert(parser:update("", true))
+    assert(parser:close())
+    assert(#result == 1)
+    return result[1]
+  end
+
+  local function encode_bytes(s)
+    local buffer = {}
+    for i = 1, #s do
+      buffer[i] = brigid.data_writer():write_json_string(s:sub(i, i)):get_string():sub(2, -2)
+    end
+    return '"' .. table.concat(buffer) .. '"'
+  end
+
+  local function check(s)
+    local source = brigid.data_writer():write_json_string(s):get_string()
+    assert(source == encode_bytes(s))
+    assert(brigid.json.parse(source) == s)
+    assert(parse_bytes(source) == s)
+
+    -- The raw bytes are accepted or rejected by both.
+    local raw = '"' .. s .. '"'
+    local value1 = brigid.json.parse(raw)
+    local result, value2 = pcall(parse_bytes, raw)
+    assert((value1 ~= nil) == result)
+    if result then
+      assert(value1 == value2)
+    end
+  end
+
+  local chars = { "\"", "\\", "\n", "\0", "\31", " ", "\127", "\128", "\255" }
+  for n = 1, 130 do
+    for _, char in ipairs(chars) do
+      for i = 1, n, 7 do
+        check(("x"):rep(i - 1) .. char .. ("y"):rep(n - i))
+      end
+    end
+  end
+  local buffer = {}
+  for i = 1, 1024 do
+    buffer[i] = string.char(math.random(0, 255))
+  end
+  check(table.concat(buffer))
+end
+
 local source = [[
 {
   "Image": {
@@ -307,6 +403,47 @@ function suite:test_json_parse_rfc3629_3()
   assert(equal(brigid.json.parse [["\u65e5\u672c\u8a9e"]], expect))
 end
 
+function suite:test_json_parse_surrogate()
+  local sources = {
+    [["\uD800"]];
+    [["\uDC00x"]];
+    [["\uD800\u0041"]];
+    [["\uDC00\uDC00"]];
+    [["\udbff\ud800"]];
+  }
+  for _, source in ipairs(sources) do
+    local result, message = brigid.json.parse(source)
+    if debug then print(message) end
+    assert(not result)
+    assert(not brigid.json.parse("{\"a\":" .. source .. "}", nil, { keep = { "a" } }))
+    assert(not brigid.json.document("[" .. source .. "]"))
+    assert(not brigid.json.parse_columns("[{\"a\":" .. source .. "}]", { "a" }))
+    assert(not brigid.json.raw(source, true))
+    assert(not pcall(function ()
+      for i, v in brigid.json.lines(source) do end
+    end))
+  end
+
+  local cases = {
+    { [["\uD800\uDC00"]], "\xF0\x90\x80\x80" };
+    { [["\uD840\uDC00"]], "\xF0\xA0\x80\x80" };
+    { [["\udbff\udfff"]], "\xF4\x8F\xBF\xBF" };
+  }
+  for _, case in ipairs(cases) do
+    local source, expected = case[1], case[2]
+    assert(brigid.json.parse(source) == expected)
+    assert(brigid.json.parse("{\"a\":" .. source .. "}", nil, { keep = { "a" } }).a == expected)
+    assert(brigid.json.document("[" .. source .. "]"):get "[1]" == expected)
+    assert(brigid.json.parse_columns("[{\"a\":" .. source .. "}]", { "a" }).a[1] == expected)
+    local n = 0
+    for i, v in brigid.json.lines(source) do
+      assert(v == expected)
+      n = n + 1
+    end
+    assert(n == 1)
+  end
+end
+
 function suite:test_json_parse_locale1()
   os.setlocale "de_DE.UTF-8"
   local result, message = brigid.json.parse "[9223372036854775808,0e-19,1]"
@@ -426,6 +563,131 @@ function suite:test_json_parse_error3()
   assert(not result)
 end
 
+function suite:test_json_parse_keep()
+  local source = [[
+{
+  "id": 42,
+  "junk": { "foo": [ 1, 2, 3 ] },
+  "user": { "name": "alice", "age": 17 },
+  "items": [ { "id": 1, "price": 100 }, { "id": 2, "price": 200 } ]
+}
+]]
+  local result = assert(brigid.json.parse(source, nil, { keep = { "id", "user.name", "items.id", "none" } }))
+  assert(equal(result, {
+    id = 42;
+    user = { name = "alice" };
+    items = { { id = 1 }, { id = 2 } };
+  }))
+  assert(getmetatable(result.items) == getmetatable(brigid.json.array()))
+
+  local result = assert(brigid.json.parse(source, nil, { keep = { "user" } }))
+  assert(equal(result, { user = { name = "alice", age = 17 } }))
+
+  local result, message = brigid.json.parse("{\"id\":1,}", nil, { keep = { "id" } })
+  if debug then print(message) end
+  assert(not result)
+
+  for _, keep in ipairs { "id", 1, true } do
+    local result, message = pcall(brigid.json.parse, "{\"id\":1}", nil, { keep = keep })
+    if debug then print(message) end
+    assert(not result)
+    assert(message:find "table expected")
+  end
+  assert(equal(brigid.json.parse("{\"id\":1}", nil, {}), { id = 1 }))
+end
+
+function suite:test_json_parse_view_threshold()
+  local blob = ("x"):rep(64)
+  local source = ([[{"%s":"%s","foo":"bar","baz":["%s","%s\n"]}]]):format(blob, blob, blob, blob)
+  local result = assert(brigid.json.parse(source, nil, { view_threshold = 32 }))
+  local view = result[blob]
+  assert(type(view) == "userdata")
+  assert(view:get_string() == blob)
+  assert(#view == 64)
+  assert(result.foo == "bar")
+  assert(type(result.baz[1]) == "userdata")
+  assert(result.baz[2] == blob .. "\n")
+
+  source = nil
+  collectgarbage()
+  collectgarbage()
+  assert(view:get_string() == blob)
+
+  local result, message = pcall(brigid.json.parse, brigid.data_writer():write(('"%s"'):format(blob)), nil, { view_threshold = 32 })
+  if debug then print(message) end
+  assert(not result)
+  assert(message:find "string source")
+end
+
+function suite:test_json_parse_columns()
+  local source = [[
+[
+  { "ts": 1, "v": 0.5, "host": "foo", "junk": [ 1, 2, 3 ] },
+  { "v": 1.5, "ts": 2 },
+  { "ts": 3, "v": 2.5, "host": "bar" }
+]
+]]
+  local columns, n = assert(brigid.json.parse_columns(source, { "ts", "v", "host" }, brigid.null))
+  assert(n == 3)
+  assert(equal(columns.ts, { 1, 2, 3 }))
+  assert(equal(columns.v, { 0.5, 1.5, 2.5 }))
+  assert(equal(columns.host, { "foo", brigid.null, "bar" }))
+  assert(columns.junk == nil)
+
+  local columns, n = assert(brigid.json.parse_columns([[ [ { "\u0076": [ 1, { "x": [ 2 ] } ] }, { "v": "\n" } ] ]], { "v" }))
+  assert(n == 2)
+  assert(equal(columns.v, { { 1, { x = { 2 } } }, "\n" }))
+  assert(getmetatable(columns.v[1]) == getmetatable(brigid.json.array()))
+
+  local result, message = brigid.json.parse_columns("{}", { "ts" })
+  if debug then print(message) end
+  assert(not result)
+end
+
+function suite:test_json_parse_columns2()
+  local sources = {
+    [[ [ { "ts": 1 }, 2 ] ]];
+    [[ [ [ 1 ] ] ]];
+    [[ [ { "ts": 1 }, null ] ]];
+  }
+  for _, source in ipairs(sources) do
+    local result, message = brigid.json.parse_columns(source, { "ts" })
+    if debug then print(message) end
+    assert(not result)
+  end
+end
+
+function suite:test_json_parse_columns_doubles()
+  local source = [[
+[
+  { "ts": 1, "v": 0.5 },
+  { "ts": 2 },
+  { "ts": 3, "v": null },
+  { "ts": 4, "v": -2e3 }
+]
+]]
+  local columns, n = assert(brigid.json.parse_columns(source, { "ts", "v" }, nil, { doubles = { "v" } }))
+  assert(n == 4)
+  assert(equal(columns.ts, { 1, 2, 3, 4 }))
+  assert(columns.v:get_size() == 32)
+
+  local ffi
+  pcall(function ()
+    ffi = require "ffi"
+  end)
+  if ffi then
+    local v = ffi.cast("const double*", columns.v:get_pointer())
+    assert(v[0] == 0.5)
+    assert(v[1] ~= v[1])
+    assert(v[2] ~= v[2])
+    assert(v[3] == -2000)
+  end
+
+  local result, message = brigid.json.parse_columns([[ [ { "v": "x" } ] ]], { "v" }, nil, { doubles = { "v" } })
+  if debug then print(message) end
+  assert(not result)
+end
+
 function suite:test_json_parse_deep_array()
   local data_writer = brigid.data_writer()
   local depth = 1024
@@ -469,6 +731,449 @@ function suite:test_json_parse_deep_object()
   assert(u == depth)
 end
 
+function suite:test_json_parse_too_deep()
+  local depth = 1025
+  local sources = {
+    { ("["):rep(depth) .. ("]"):rep(depth), "position 1025" };
+    { ('{"foo":'):rep(depth - 1) .. "{}" .. ("}"):rep(depth - 1), "position 7169" };
+  }
+  for _, source in ipairs(sources) do
+    local result, message = brigid.json.parse(source[1])
+    if debug then print(message) end
+    assert(not result)
+    assert(message:find(source[2]))
+    local result, message = brigid.json.validate(source[1])
+    assert(not result)
+    assert(message:find(source[2]))
+    assert(not brigid.json.document(source[1]))
+    assert(not brigid.json.parse(source[1], nil, { keep = { "foo" } }))
+  end
+end
+
+function suite:test_json_parser1()
+  local result = {}
+  local parser = assert(brigid.json.parser(function (value)
+    result[#result + 1] = value
+  end))
+
+  assert(parser:update [=[{"foo":[1,2]=])
+  assert(#result == 0)
+  assert(parser:update [=[,"b}]\"ar"]}[true,false,null] "baz" 4]=])
+  assert(#result == 3)
+  assert(parser:update("2 ", true))
+  assert(#result == 4)
+  assert(parser:close())
+
+  assert(equal(result[1], { foo = { 1, 2, "b}]\"ar" } }))
+  assert(equal(result[2], { true, false }))
+  assert(result[3] == "baz")
+  assert(result[4] == 42)
+end
+
+function suite:test_json_parser2()
+  local source = [[
+{
+  "Image": {
+      "Width":  800,
+      "Height": 600,
+      "Title":  "View from 15th Floor",
+      "Thumbnail": {
+          "Url":    "http://www.example.com/image/481989943",
+          "Height": 125,
+          "Width":  100
+      },
+      "Animated" : false,
+      "IDs": [116, 943, 234, 38793]
+    }
+}
+]]
+
+  local result = {}
+  local parser = brigid.json.parser(function (value)
+    result[#result + 1] = value
+  end, brigid.null)
+
+  for i = 1, #source do
+    assert(parser:update(source:sub(i, i)))
+  end
+  assert(parser:update("", true))
+
+  assert(#result == 1)
+  assert(equal(result[1], brigid.json.parse(source)))
+end
+
+function suite:test_json_parser3()
+  local parser = brigid.json.parser(function () end)
+
+  local result, message = parser:update "[1,2]["
+  assert(result)
+  local result, message = parser:update("3", true)
+  if debug then print(message) end
+  assert(not result)
+
+  local result, message = parser:update "[1,]"
+  if debug then print(message) end
+  assert(not result)
+
+  assert(parser:update("[3]", true))
+  assert(parser:close())
+
+  local result, message = pcall(function () parser:update "[]" end)
+  if debug then print(message) end
+  assert(not result)
+  assert(message:find "bad self" or message:find "bad argument")
+end
+
+function suite:test_json_parser4()
+  local result = {}
+  local parser = brigid.json.parser(function (value)
+    result[#result + 1] = value
+  end)
+
+  assert(parser:update "12")
+  assert(parser:update "34")
+  assert(#result == 0)
+  assert(parser:update " \"a\\")
+  assert(parser:update "u00")
+  assert(parser:update "e9b\" -1.")
+  assert(#result == 2)
+  assert(parser:update("5e1", true))
+  assert(#result == 3)
+
+  assert(result[1] == 1234)
+  assert(result[2] == "a\195\169b")
+  assert(result[3] == -15)
+
+  local result, message = parser:update "[1] [2"
+  assert(result)
+  local result, message = parser:update(",x]", true)
+  if debug then print(message) end
+  assert(not result)
+  assert(message:find "position 8")
+  assert(parser:close())
+end
+
+function suite:test_json_document1()
+  local doc = assert(brigid.json.document [[
+{
+  "foo": "first",
+  "f\u006F\u006F": { "bar": [ 17, 23, { "baz": "qux" }, 42 ] },
+  "nil": null
+}
+]])
+  assert(doc:type() == "object")
+  assert(#doc == 3)
+  assert(doc:get "foo.bar[1]" == 17)
+  assert(doc:get "foo.bar[3].baz" == "qux")
+  assert(doc:get "foo.bar[4]" == 42)
+  assert(doc:get "foo.bar[5]" == nil)
+  assert(doc:get "foo.baz" == nil)
+  assert(doc:type "foo.bar" == "array")
+  assert(doc:type "nil" == "null")
+  assert(doc:type "none" == nil)
+
+  local bar = doc:get "foo.bar"
+  assert(type(bar) == "userdata")
+  assert(#bar == 4)
+  assert(doc:get_size() == 3)
+  assert(doc:get_size "foo.bar" == 4)
+  assert(doc:get_size "foo.bar[3]" == 1)
+  assert(doc:get_size "none" == nil)
+  assert(bar:get "[3].baz" == "qux")
+  assert(equal(bar:materialize(), { 17, 23, { baz = "qux" }, 42 }))
+  assert(getmetatable(bar:materialize()) == getmetatable(brigid.json.array()))
+
+  local keys = {}
+  for k, v in doc:each() do
+    if debug then print(k, v) end
+    keys[#keys + 1] = k
+  end
+  assert(equal(keys, { "foo", "foo", "nil" }))
+
+  local n = 0
+  for i, v in doc:each "foo.bar" do
+    n = n + i
+  end
+  assert(n == 10)
+
+  local result, message = pcall(function () doc:get "foo[x]" end)
+  if debug then print(message) end
+  assert(not result)
+end
+
+function suite:test_json_document2()
+  local doc = assert(brigid.json.document("[null,{\"a\":null}]", brigid.null))
+  assert(doc:get "[1]" == brigid.null)
+  assert(doc:get "[2].a" == brigid.null)
+  assert(equal(doc:materialize(), { brigid.null, { a = brigid.null } }))
+
+  local data_writer = brigid.data_writer():write "[1,2"
+  local result, message = brigid.json.document(data_writer)
+  if debug then print(message) end
+  assert(not result)
+  data_writer:write "]"
+  local doc = assert(brigid.json.document(data_writer))
+  data_writer:write ",3]"
+  assert(equal(doc:materialize(), { 1, 2 }))
+end
+
+function suite:test_json_lines1()
+  local data_writer = brigid.data_writer()
+  data_writer:write [[
+{"foo":1}
+
+[1,2,3]
+null
+"bar"
+]]
+  local result = {}
+  for i, v in brigid.json.lines(data_writer, brigid.null) do
+    result[i] = v
+  end
+  assert(#result == 4)
+  assert(equal(result[1], { foo = 1 }))
+  assert(equal(result[2], { 1, 2, 3 }))
+  assert(result[3] == brigid.null)
+  assert(result[4] == "bar")
+
+  local n = 0
+  for i, v in brigid.json.lines "1\r\n2\r\n3" do
+    n = n + v
+  end
+  assert(n == 6)
+end
+
+function suite:test_json_lines2()
+  local result, message = pcall(function ()
+    for i, v in brigid.json.lines "1\n[\n3\n" do end
+  end)
+  if debug then print(message) end
+  assert(not result)
+  assert(message:find "line 2")
+end
+
+function suite:test_json_lines3()
+  local data_writer = brigid.data_writer()
+  for i = 1, 1000 do
+    data_writer:write_json { id = i, foo = { i, tostring(i) } }
+    data_writer:write(i % 3 == 0 and "\n\n" or "\r\n")
+  end
+  local expect = {}
+  for i, v in brigid.json.lines(data_writer) do
+    expect[i] = v
+  end
+  assert(#expect == 1000)
+
+  for _, threads in ipairs { 2, 4, 0 } do
+    for _, batch_size in ipairs { 1, 100, 1024 * 1024 } do
+      local result = {}
+      for i, v in brigid.json.lines(data_writer, nil, { threads = threads, batch_size = batch_size }) do
+        result[i] = v
+      end
+      assert(equal(result, expect))
+    end
+  end
+
+  data_writer:write "[1,\n"
+  local n = 0
+  local result, message = pcall(function ()
+    for i in brigid.json.lines(data_writer, nil, { threads = 4, batch_size = 100 }) do
+      n = i
+    end
+  end)
+  if debug then print(message) end
+  assert(not result)
+  assert(n == 1000)
+  assert(message:find "line 1334")
+end
+
+function suite:test_json_lines4()
+  local data_writer = brigid.data_writer():write "1\n2\n"
+  local result = {}
+  for i, v in brigid.json.lines(data_writer) do
+    result[i] = v
+    if i == 1 then
+      data_writer:write "3\n"
+    end
+  end
+  assert(equal(result, { 1, 2, 3 }))
+
+  for _, threads in ipairs { 1, 2 } do
+    local data_writer = brigid.data_writer():write "1\n2\n3\n"
+    local result, message = pcall(function ()
+      for i in brigid.json.lines(data_writer, nil, { threads = threads, batch_size = 1 }) do
+        data_writer:consume(2)
+      end
+    end)
+    if debug then print(message) end
+    assert(not result)
+    assert(message:find "consumed")
+  end
+end
+
+function suite:test_json_validate()
+  assert(brigid.json.validate '{"a":[1,-2.5e3,true,false,null,"\\u3042"]}')
+  assert(brigid.json.validate ' [ ] ')
+  local result, message = brigid.json.validate '{"a":[1,2}'
+  if debug then print(message) end
+  assert(not result)
+  assert(message:find "position 10")
+  assert(not brigid.json.validate '"\\x"')
+  assert(not brigid.json.validate '01')
+  assert(not brigid.json.validate '[] []')
+end
+
+function suite:test_json_validate_parse()
+  local sources = {
+    " { ";
+    " { {} } ";
+    " [ nan ] ";
+    '{"a":[1,2}';
+    '"\\x"';
+    "01";
+    "[] []";
+    "[1,]";
+    "[1,2,";
+    "{";
+    "";
+    "-";
+    "1.";
+    "1e";
+    "tru";
+    '"\\u12"';
+    [["\uD800"]];
+    [["\uDC00x"]];
+    [["\uD800\u0041"]];
+    [["\uDC00\uDC00"]];
+    [["\udbff\ud800"]];
+    [["\uD834\uDD1E"]];
+    '{"a":[1,-2.5e3,true,false,null,"\\u3042"]}';
+  }
+  for _, source in ipairs(sources) do
+    local _, message1 = brigid.json.validate(source)
+    local _, message2 = brigid.json.parse(source)
+    if debug then print(source, message1, message2) end
+    assert(not message1 == not message2)
+    if message1 then
+      assert(message1:match "position %d+" == message2:match "position %d+")
+    end
+  end
+end
+
+function suite:test_json_write_json_reformat()
+  local source = ' { "a" : [ 1 , 1.50 , 1e17 ] , "b\\n" : { } , "c" : [ ] , "d" : { "e" : null } } '
+  local result = brigid.data_writer():write_json_reformat(source):get_string()
+  assert(result == '{"a":[1,1.50,1e17],"b\\n":{},"c":[],"d":{"e":null}}')
+
+  local result = brigid.data_writer():write_json_reformat(source, 2):get_string()
+  if debug then print(result) end
+  assert(result == [[
+{
+  "a": [
+    1,
+    1.50,
+    1e17
+  ],
+  "b\n": {},
+  "c": [],
+  "d": {
+    "e": null
+  }
+}]])
+
+  local data_writer = brigid.data_writer()
+  local result, message = data_writer:write_json_reformat '[1,2,'
+  assert(not result)
+  assert(message:find "position 6")
+
+  assert(not pcall(function () data_writer:write_json_reformat("[1]", -1) end))
+end
+
+function suite:test_json_raw()
+  local profile = brigid.json.raw('{"name":"foo","ids":[1,2]}', true)
+  assert(#profile == 26)
+  assert(tostring(profile) == '{"name":"foo","ids":[1,2]}')
+  local result = brigid.data_writer():write_json { profile, profile, brigid.json.raw "1.50" }:get_string()
+  assert(result == '[{"name":"foo","ids":[1,2]},{"name":"foo","ids":[1,2]},1.50]')
+
+  assert(brigid.json.raw "{")
+  local result, message = brigid.json.raw("{", true)
+  if debug then print(message) end
+  assert(not result)
+end
+
+function suite:test_json_encoder()
+  local data_writer = brigid.data_writer()
+  local encoder = brigid.json.encoder(data_writer)
+  encoder:begin_object():key "rows":begin_array()
+  for i = 1, 3 do
+    encoder:value { i, "x" }
+  end
+  encoder:end_array():key "empty":begin_object():end_object()
+  encoder:key "raw":value(brigid.json.raw "[true]")
+  encoder:end_object()
+  assert(data_writer:get_string() == '{"rows":[[1,"x"],[2,"x"],[3,"x"]],"empty":{},"raw":[true]}')
+
+  local data_writer = brigid.data_writer()
+  local encoder = brigid.json.encoder(data_writer, 2)
+  encoder:begin_array():value(1):begin_object():key "a":value { b = true }:end_object():end_array()
+  if debug then print(data_writer:get_string()) end
+  assert(data_writer:get_string() == [==[
+[
+  1,
+  {
+    "a": {
+      "b": true
+    }
+  }
+]]==])
+
+  local encoder = brigid.json.encoder(brigid.data_writer())
+  encoder:begin_object()
+  assert(not pcall(encoder.value, encoder, 1))
+  assert(not pcall(encoder.end_array, encoder))
+  encoder:end_object()
+  assert(not pcall(encoder.value, encoder, 1))
+
+  assert(not pcall(brigid.json.encoder, brigid.data_writer(), -1))
+  local data_writer = brigid.data_writer()
+  data_writer:close()
+  assert(not pcall(brigid.json.encoder, data_writer))
+end
+
+function suite:test_json_compile()
+  local schema = brigid.json.compile {
+    "id";
+    { "name", "string" };
+    { "ok", "boolean" };
+    { "pos", { { "x", "number" }, "y" } };
+    { "tags", "any" };
+  }
+  local data_writer = brigid.data_writer()
+  schema:write(data_writer, { id = 1, name = "foo", ok = true, pos = { x = 1.5 }, tags = { "a" }, extra = 0 })
+  schema:write(data_writer, { id = 2, name = "bar", pos = {} })
+  assert(data_writer:get_string() == '{"id":1,"name":"foo","ok":true,"pos":{"x":1.5,"y":null},"tags":["a"]}'
+    .. '{"id":2,"name":"bar","ok":null,"pos":{"x":null,"y":null},"tags":null}')
+
+  local result, message = pcall(schema.write, schema, brigid.data_writer(), { name = 42 })
+  if debug then print(message) end
+  assert(not result)
+  assert(message:find "field name: string expected")
+  assert(not pcall(brigid.json.compile, { { "x", "unknown" } }))
+
+  for _, field in ipairs { 1, { 1, "number" }, { "pos", { 2 } } } do
+    local result, message = pcall(brigid.json.compile, { field })
+    if debug then print(message) end
+    assert(not result)
+    assert(message:find "string expected for the key of a field")
+  end
+
+  local key = ("\n"):rep(100)
+  local schema = brigid.json.compile { key }
+  local result = brigid.data_writer():write_json { [key] = 1 }:get_string()
+  assert(schema:write(brigid.data_writer(), { [key] = 1 }):get_string() == result)
+end
+
 function suite:test_json_write_and_parse1()
   local source = {
     Image = {
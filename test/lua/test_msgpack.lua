@@ -0,0 +1,94 @@
+-- Copyright (c) 2026 <dev@brigid.jp>
+-- This software is released under the MIT License.
+-- https://opensource.org/licenses/mit-license.php
+
+local brigid = require "brigid"
+local test_suite = require "test_suite"
+
+local suite = test_suite "test_msgpack"
+local debug = test_debug()
+
+local function equal(self, that)
+  if self == that then
+    return true
+  end
+  if type(self) == "table" and type(that) == "table" then
+    for k, v in pairs(self) do
+      if not equal(v, that[k]) then
+        return false
+      end
+    end
+    for k, v in pairs(that) do
+      if self[k] == nil then
+        return false
+      end
+    end
+    return true
+  end
+end
+
+local function encode(value)
+  return brigid.data_writer():write_msgpack(value):get_string()
+end
+
+local function hex(source)
+  return (source:gsub(".", function (c) return ("%02x"):format(c:byte()) end))
+end
+
+function suite:test_msgpack_write_integer()
+  assert(hex(encode(0)) == "00")
+  assert(hex(encode(127)) == "7f")
+  assert(hex(encode(128)) == "cc80")
+  assert(hex(encode(256)) == "cd0100")
+  assert(hex(encode(65536)) == "ce00010000")
+  assert(hex(encode(4294967296)) == "cf0000000100000000")
+  assert(hex(encode(-1)) == "ff")
+  assert(hex(encode(-32)) == "e0")
+  assert(hex(encode(-33)) == "d0df")
+  assert(hex(encode(-129)) == "d1ff7f")
+  assert(hex(encode(-32769)) == "d2ffff7fff")
+  assert(hex(encode(-2147483649)) == "d3ffffffff7fffffff")
+end
+
+function suite:test_msgpack_write()
+  assert(hex(encode(nil)) == "c0")
+  assert(hex(encode(brigid.null)) == "c0")
+  assert(hex(encode(true)) == "c3")
+  assert(hex(encode(false)) == "c2")
+  assert(hex(encode(1.5)) == "cb3ff8000000000000")
+  assert(hex(encode "foo") == "a3666f6f")
+  assert(hex(encode(("x"):rep(32))) == "d920" .. ("78"):rep(32))
+  assert(hex(encode(brigid.data_writer():write "foo")) == "c403666f6f")
+  assert(hex(encode {}) == "80")
+  assert(hex(encode(brigid.json.array())) == "90")
+  assert(hex(encode { 1, 2, { a = true } }) == "930102" .. "81a161c3")
+  assert(hex(encode { [10] = "x" }) == "810aa178")
+end
+
+function suite:test_msgpack_parse()
+  local source = {
+    id = 42;
+    name = "foo";
+    score = -2.5;
+    tags = { "a", "b", brigid.null };
+    empty = brigid.json.array();
+    nested = { [1.5] = true, [7] = false };
+  }
+  local result = brigid.msgpack.parse(encode(source), brigid.null)
+  assert(equal(result, source))
+  assert(getmetatable(result.tags) == getmetatable(brigid.json.array()))
+  assert(getmetatable(result.empty) == getmetatable(brigid.json.array()))
+  assert(brigid.msgpack.parse(brigid.data_writer():write_msgpack "bar") == "bar")
+  assert(brigid.msgpack.parse "\202\063\192\000\000" == 1.5)
+end
+
+function suite:test_msgpack_parse_error()
+  for _, source in ipairs { "", "\146\001", "\193", "\001\002", "\129\192\001", "\212\000\000", "\221\255\255\255\255" } do
+    local result, message = brigid.msgpack.parse(source)
+    if debug then print(message) end
+    assert(not result)
+    assert(message:find "cannot parse msgpack")
+  end
+end
+
+return suite
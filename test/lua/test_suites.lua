@@ -1,4 +1,4 @@
--- Copyright (c) 2021 <dev@brigid.jp>
+-- Copyright (c) 2021,2026 <dev@brigid.jp>
 -- This software is released under the MIT License.
 -- https://opensource.org/licenses/mit-license.php
 
@@ -9,6 +9,7 @@ local test_suite_names = {
   "test_crypto";
   "test_http";
 
+  "test_cbor";
   "test_common";
   "test_to_be_closed";
   "test_data";
@@ -16,6 +17,7 @@ local test_suite_names = {
   "test_data_writer";
   "test_file_writer";
   "test_json";
+  "test_msgpack";
   "test_stopwatch";
 }
 
@@ -1,4 +1,4 @@
--- Copyright (c) 2021 <dev@brigid.jp>
+-- Copyright (c) 2021,2026 <dev@brigid.jp>
 -- This software is released under the MIT License.
 -- https://opensource.org/licenses/mit-license.php
 
@@ -57,4 +57,48 @@ function suite:test_view()
   assert(message:find "bad self" or message:find "bad argument")
 end
 
+function suite:test_view_map()
+  local path = test_cwd.."/test_view_map.dat"
+  local data = {}
+  for i = 1, 1000 do
+    data[i] = ("%05d\n"):format(i)
+  end
+  data = table.concat(data)
+  local out = assert(io.open(path, "wb"))
+  out:write(data)
+  out:close()
+
+  local view = assert(brigid.view.map(path))
+  assert(view:get_string() == data)
+  assert(brigid.hasher "sha256":update(view):digest() == brigid.hasher "sha256":update(data):digest())
+  assert(brigid.memory_stats().view >= #data)
+  assert(view:close())
+  assert(view:close()) -- can close
+
+  local result, message = pcall(function () view:get_string() end)
+  if debug then print(message) end
+  assert(not result)
+
+  local view = assert(brigid.view.map(path, 4099, 12))
+  assert(view:get_string() == data:sub(4100, 4111))
+  assert(view:close())
+
+  local view = assert(brigid.view.map(path, #data))
+  assert(view:get_size() == 0)
+
+  local result, message = brigid.view.map(path, #data + 1)
+  if debug then print(message) end
+  assert(not result)
+
+  local result, message = brigid.view.map(path, 0, #data + 1)
+  if debug then print(message) end
+  assert(not result)
+
+  local result, message = brigid.view.map(test_cwd.."/no such file")
+  if debug then print(message) end
+  assert(not result)
+
+  os.remove(path)
+end
+
 return suite
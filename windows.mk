@@ -1,4 +1,4 @@
-# Copyright (c) 2019-2021,2024 <dev@brigid.jp>
+# Copyright (c) 2019-2021,2024,2026 <dev@brigid.jp>
 # This software is released under the MIT License.
 # https://opensource.org/licenses/mit-license.php
 
@@ -6,6 +6,8 @@ CPPFLAGS = /I$(LUA_INCDIR) /I. /D_CRT_SECURE_NO_WARNINGS
 CXXFLAGS = $(CFLAGS) /W3 /EHsc
 
 OBJS = \
+	src\lua\buffer_pool.obj \
+	src\lua\cbor.obj \
 	src\lua\common.obj \
 	src\lua\common_windows.obj \
 	src\lua\crypto.obj \
@@ -22,8 +24,21 @@ OBJS = \
 	src\lua\http_impl.obj \
 	src\lua\http_windows.obj \
 	src\lua\json.obj \
+	src\lua\json_columns.obj \
+	src\lua\json_compile.obj \
+	src\lua\json_document.obj \
+	src\lua\json_encoder.obj \
+	src\lua\json_format.obj \
+	src\lua\json_lines.obj \
 	src\lua\json_parse.obj \
+	src\lua\json_parser.obj \
+	src\lua\json_projection.obj \
+	src\lua\json_raw.obj \
+	src\lua\json_tape.obj \
+	src\lua\memory.obj \
 	src\lua\module.obj \
+	src\lua\msgpack.obj \
+	src\lua\number.obj \
 	src\lua\new_decryptor.obj \
 	src\lua\new_encryptor.obj \
 	src\lua\scope_exit.obj \